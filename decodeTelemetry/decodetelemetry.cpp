@@ -0,0 +1,129 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#include "telemetry.h"
+#include "loveylib/endian.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define ERR(condition, msg) if (condition) {puts(msg); exit(1);}
+
+// Print event arguments with format
+// Returns false if the arguments don't match the format
+static bool PrintEvent(const char *format, const unsigned char *args, unsigned size) {
+  for (const char *c = format; *c; ++c) {
+    if ((*c != '%') || !c[1]) {
+      putchar(*c);
+      continue;
+    }
+
+    // Read argument for conversion
+    unsigned argSize;
+    switch (*++c) {
+    case 'u': case 'i': case 'f': argSize = 4; break;
+    case 'U': argSize = 8; break;
+    default: putchar(*c); continue;
+    }
+
+    if (size < argSize) return false;
+
+    u32 v32;
+    u64 v64;
+    f32 f;
+    switch (*c) {
+    case 'u': memcpy(&v32, args, 4); printf("%u", (unsigned)v32); break;
+    case 'i': memcpy(&v32, args, 4); printf("%d", (int)(i32)v32); break;
+    case 'f': memcpy(&f, args, 4); printf("%f", (double)f); break;
+    case 'U': memcpy(&v64, args, 8); printf("%llu", (unsigned long long)v64); break;
+    }
+
+    args += argSize;
+    size -= argSize;
+  }
+
+  return !size;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("Usage: %s <telemetry file>\n"
+           "\n"
+           "Prints every event in <telemetry file>, like %s,\n"
+           "with its time in seconds since the first event\n", argv[0], TELEMETRY_FILENAME);
+    return 0;
+  }
+
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    printf("Cannot open \"%s\"!\n", argv[1]);
+    return 1;
+  }
+
+  telemetry_file_hdr_t hdr;
+  ERR(fread(&hdr, sizeof(hdr), 1, f) < 1, "Couldn't read header!");
+  ERR(hdr.magic == ByteSwap32(TELEMETRY_MAGIC),
+      "File was written with the other byte order, decode it on a machine like the one that wrote it!");
+  ERR(hdr.magic != TELEMETRY_MAGIC, "Not a telemetry file!");
+  ERR(hdr.version != TELEMETRY_VERSION, "Unsupported telemetry version!");
+  ERR(!hdr.timerFrequency, "Invalid timer frequency!");
+
+  static unsigned char args[65536];
+  unsigned char rec[TELEMETRY_RECORD_HDR_SIZE];
+  bool first = true;
+  u64 start = 0;
+
+  while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+    u64 time;
+    u16 event, size;
+    memcpy(&time, rec, 8);
+    memcpy(&event, rec+8, 2);
+    memcpy(&size, rec+10, 2);
+
+    ERR(fread(args, 1, size, f) < size, "Truncated event!");
+
+    if (first) {
+      start = time;
+      first = false;
+    }
+
+    printf("[%12.6f] ", (double)(time-start)/(double)hdr.timerFrequency);
+
+    if (event >= TEL_COUNT) printf("Unknown event %u (%u bytes)", (unsigned)event, (unsigned)size);
+    else if (!PrintEvent(S_TelemetryEvents[event].format, args, size))
+      printf(" (event %u has the wrong size)", (unsigned)event);
+
+    putchar('\n');
+  }
+
+  fclose(f);
+  return 0;
+}
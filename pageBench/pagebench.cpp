@@ -0,0 +1,326 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+// Benchmark for the page decoders in src/page.cpp, compares the RLE
+// decoder against the old pixel-at-a-time decoder, and the v2 band
+// decoder against both
+
+#include "page.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#define ERR(condition, msg) if (condition) {puts(msg); exit(1);}
+
+static const size_t PAGE_PIXELS = 2048*2048;
+
+static unsigned *s_page; // Decoded page, for checking output
+static unsigned *s_out;
+
+static unsigned char *s_input; // Compressed page
+static size_t s_inputSize;
+
+///////////////////////////////////
+// Old decoder, reads from s_input instead of a file
+
+static inline bool IsMarker(unsigned pixel) {
+  return (pixel>>24) == 0x80;
+}
+
+struct decompress_state_t {
+  unsigned repCnt; // 0 == not repeating
+  unsigned curPixel;
+  size_t filePos;
+
+  #define PIXEL_CACHE_SIZE 4096
+  unsigned pixelCache[PIXEL_CACHE_SIZE];
+  size_t pixelCacheCursor;
+};
+
+static void InitDecompression(decompress_state_t *state) {
+  state->repCnt = 0;
+  state->filePos = 0;
+  state->pixelCacheCursor = PIXEL_CACHE_SIZE-1;
+}
+
+static unsigned ReadPixel(decompress_state_t *state) {
+  if (state->pixelCacheCursor < PIXEL_CACHE_SIZE-1) {
+    return state->pixelCache[++state->pixelCacheCursor];
+  }
+
+  size_t size = sizeof(state->pixelCache);
+  if (size > s_inputSize-state->filePos) size = s_inputSize-state->filePos;
+  memcpy(state->pixelCache, s_input+state->filePos, size);
+  state->filePos += size;
+
+  state->pixelCacheCursor = 0;
+  return state->pixelCache[0];
+}
+
+static unsigned WritePixel(decompress_state_t *state) {
+  if (state->repCnt) {
+    --state->repCnt;
+    return state->curPixel;
+  }
+
+  unsigned ret = ReadPixel(state);
+  if (IsMarker(ret)) {
+    state->repCnt = ret&0xffffff;
+    state->curPixel = ReadPixel(state);
+    return state->curPixel;
+  }
+
+  return ret;
+}
+
+static decompress_state_t s_decomp;
+
+static void DecodeOld() {
+  InitDecompression(&s_decomp);
+  for (size_t i = 0; i < PAGE_PIXELS; ++i)
+    s_out[i] = WritePixel(&s_decomp);
+}
+
+///////////////////////////////////
+// New decoder, fed 64KB chunks like the page streamer
+
+static const size_t INPUT_WORDS = 16384;
+static unsigned s_chunk[INPUT_WORDS];
+
+static void DecodeNew() {
+  rle_decoder_t d;
+  InitRLEDecoder(&d);
+
+  size_t pos = 0, written = 0;
+  for (;;) {
+    written += DecodeRLE(&d, s_out+written, PAGE_PIXELS-written);
+    if (written == PAGE_PIXELS) break;
+
+    size_t left = RLEInputLeft(&d);
+    if (left) memmove(s_chunk, d.in, left*4);
+
+    size_t size = (INPUT_WORDS-left)*4;
+    if (size > s_inputSize-pos) size = s_inputSize-pos;
+    ERR(size < 4, "Compressed page is truncated!");
+
+    memcpy(s_chunk+left, s_input+pos, size);
+    pos += size;
+    FeedRLEDecoder(&d, s_chunk, left+size/4);
+  }
+}
+
+///////////////////////////////////
+// v2 decoder, bands decoded in parallel like the page streamer
+
+static const unsigned V2_MAX_THREADS = 4;
+
+static unsigned s_v2Threads;
+static unsigned char *s_v2;
+static size_t s_v2Size;
+static page_band_t s_bands[PAGE_BANDS];
+static std::atomic<size_t> s_nextBand;
+
+static void DecodeV2Bands() {
+  for (;;) {
+    size_t band = s_nextBand.fetch_add(1);
+    if (band >= PAGE_BANDS) return;
+
+    ERR(!DecodePageBand(s_v2+s_bands[band].offset, s_bands[band].size, s_out+band*PAGE_BAND_PIXELS),
+        "Corrupt v2 band!");
+  }
+}
+
+static void DecodeV2() {
+  ERR(!ReadPageTable(s_v2, s_v2Size, s_bands), "Invalid v2 page!");
+
+  s_nextBand = 0;
+  DecodeV2Bands();
+}
+
+// Starting the helpers publishes s_bands and s_nextBand to them,
+// joining them publishes the page they decoded
+static void DecodeV2Parallel() {
+  ERR(!ReadPageTable(s_v2, s_v2Size, s_bands), "Invalid v2 page!");
+
+  s_nextBand = 0;
+  std::thread helpers[V2_MAX_THREADS-1];
+  for (unsigned i = 1; i < s_v2Threads; ++i) helpers[i-1] = std::thread(DecodeV2Bands);
+  DecodeV2Bands();
+  for (unsigned i = 1; i < s_v2Threads; ++i) helpers[i-1].join();
+}
+
+// Encode s_page into s_v2
+static void EncodePageV2() {
+  page_encoder_t *e = (page_encoder_t*)malloc(sizeof(page_encoder_t));
+  s_v2 = (unsigned char*)malloc(PAGE_TABLE_SIZE + PAGE_BAND_BOUND*PAGE_BANDS);
+  ERR(!e || !s_v2, "Out of memory!");
+
+  page_hdr_t hdr;
+  hdr.magic = PAGE_MAGIC;
+  hdr.version = PAGE_VERSION;
+  hdr.bandCount = PAGE_BANDS;
+  hdr.width = PAGE_WIDTH;
+  hdr.height = PAGE_HEIGHT;
+  memcpy(s_v2, &hdr, sizeof(hdr));
+
+  size_t offset = PAGE_TABLE_SIZE;
+  for (size_t i = 0; i < PAGE_BANDS; ++i) {
+    const u8 *band;
+    size_t size = EncodePageBand(e, s_page + i*PAGE_BAND_PIXELS, &band);
+    memcpy(s_v2+offset, band, size);
+
+    page_band_t b;
+    b.offset = offset;
+    b.size = size;
+    memcpy(s_v2 + sizeof(hdr) + i*sizeof(b), &b, sizeof(b));
+
+    offset += size;
+  }
+
+  s_v2Size = offset;
+  free(e);
+}
+
+///////////////////////////////////
+// Test page
+
+// Encode s_page into s_input, same format as toCPage
+static void EncodePage() {
+  unsigned *out = (unsigned*)malloc(PAGE_PIXELS*8);
+  size_t o = 0;
+
+  for (size_t i = 0; i < PAGE_PIXELS;) {
+    size_t n = 1;
+    while ((i+n < PAGE_PIXELS) && (s_page[i+n] == s_page[i]) && (n < 0x1000000)) ++n;
+
+    if (n > 1) {
+      out[o++] = 0x80000000 | (unsigned)(n-1);
+      out[o++] = s_page[i];
+    } else out[o++] = s_page[i];
+
+    i += n;
+  }
+
+  s_input = (unsigned char*)out;
+  s_inputSize = o*4;
+}
+
+// Build a page that looks like a sprite sheet: large clear areas,
+// flat tiles, gradients and noisy sprites
+static void GeneratePage() {
+  unsigned seed = 1;
+  for (size_t y = 0; y < 2048; ++y) {
+    for (size_t x = 0; x < 2048; ++x) {
+      unsigned *p = s_page + y*2048 + x;
+      const size_t cell = (y/64)*32 + x/64;
+
+      seed = seed*1103515245 + 12345;
+      switch (cell%5) {
+      case 0: *p = 0; break;
+      case 1: *p = 0xff000000 | (unsigned)(cell*0x10101); break;
+      case 2: *p = 0xff000000 | (unsigned)(((x*3)&0xff) | (((y*5)&0xff)<<8) | (((x+y)&0xff)<<16)); break;
+      case 3: *p = 0xff000000 | (unsigned)((x&0xff)*0x10101); break;
+      default: *p = 0xff000000 | ((seed>>8)&0xffffff); break;
+      }
+    }
+  }
+}
+
+// Load a decoded page from a raw page file
+static void LoadPage(const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    printf("Cannot open \"%s\"!\n", filename);
+    exit(1);
+  }
+
+  ERR(fread(s_page, 4, PAGE_PIXELS, f) < PAGE_PIXELS, "Couldn't read page!");
+  fclose(f);
+
+  for (size_t i = 0; i < PAGE_PIXELS; ++i)
+    ERR(IsMarker(s_page[i]), "A pixel in this page has the same alpha as the RLE marker magic!");
+}
+
+static double Bench(const char *name, void (*decode)(), int iterations) {
+  memset(s_out, 0xcd, PAGE_PIXELS*4);
+
+  double best = 1e9;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    decode();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now()-start;
+    if (t.count() < best) best = t.count();
+  }
+
+  ERR(memcmp(s_out, s_page, PAGE_PIXELS*4), "Decoded page doesn't match!");
+
+  printf("%-4s %8.3f ms  %8.1f MB/s\n", name, best*1000.0, PAGE_PIXELS*4/best/1000000.0);
+  return best;
+}
+
+int main(int argc, char **argv) {
+  s_page = (unsigned*)malloc(PAGE_PIXELS*4);
+  s_out = (unsigned*)malloc(PAGE_PIXELS*4);
+  ERR(!s_page || !s_out, "Out of memory!");
+
+  if (argc > 1) LoadPage(argv[1]);
+  else GeneratePage();
+
+  EncodePage();
+  EncodePageV2();
+  printf("RLE size: %zu bytes (%.1f%%)\n", s_inputSize, s_inputSize*100.0/(PAGE_PIXELS*4));
+  printf("v2 size:  %zu bytes (%.1f%%)\n", s_v2Size, s_v2Size*100.0/(PAGE_PIXELS*4));
+
+  const int iterations = 20;
+  double o = Bench("old", DecodeOld, iterations);
+  double n = Bench("new", DecodeNew, iterations);
+  double v = Bench("v2", DecodeV2, iterations);
+  printf("Speedup: %.2fx new, %.2fx v2\n", o/n, o/v);
+
+  // Parallel decode can only be faster with more than one CPU
+  s_v2Threads = std::thread::hardware_concurrency();
+  if (s_v2Threads > V2_MAX_THREADS) s_v2Threads = V2_MAX_THREADS;
+  if (s_v2Threads < 2) {
+    puts("Only one CPU, skipping parallel v2 decode");
+    return 0;
+  }
+
+  char name[8];
+  snprintf(name, sizeof(name), "v2x%u", s_v2Threads);
+  double p = Bench(name, DecodeV2Parallel, iterations);
+  printf("Parallel speedup: %.2fx over v2\n", v/p);
+
+  return 0;
+}
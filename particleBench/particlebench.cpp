@@ -0,0 +1,103 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+// Benchmark for the particle system in src/particle.cpp, times
+// updating 100k particles and expanding them into quads like
+// DrawQuadInstances does
+
+#include "particle.h"
+#include "draw.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#define ERR(condition, msg) if (condition) {puts(msg); exit(1);}
+
+static const size_t PARTICLES = 100000;
+
+static vertex_t *s_verts; // Frame vertices, PARTICLES quads
+
+// DrawParticles draws through this, without a renderer the
+// quads are only expanded
+void DrawQuadInstances(const rquad_t *quad, const f32 *x, const f32 *y, uptr count) {
+  ExpandQuadInstances(s_verts, quad, x, y, count);
+}
+
+static particle_system_t *s_ps;
+static rquad_t s_quad;
+
+static void Update() {
+  UpdateParticles(s_ps);
+}
+
+static void Draw() {
+  DrawParticles(s_ps, &s_quad);
+}
+
+static double Bench(const char *name, void (*func)(), int iterations) {
+  double best = 1e9;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now()-start;
+    if (t.count() < best) best = t.count();
+  }
+
+  printf("%-6s %8.1f us  %6.2f ns/particle\n", name, best*1000000.0, best*1000000000.0/PARTICLES);
+  return best;
+}
+
+int main() {
+  // Same layout CreateParticleSystem uses, with room for the header
+  const size_t size = 4096 + PARTICLES*sizeof(f32)*5;
+  void *mem = aligned_alloc(64, size);
+  s_verts = (vertex_t*)aligned_alloc(64, PARTICLES*sizeof(rquad_t));
+  ERR(!mem || !s_verts, "Out of memory!");
+
+  s_ps = CreateParticleSystem(mem, size);
+  ERR(!s_ps || (s_ps->capacity < PARTICLES), "Couldn't create particle system!");
+
+  srand(1);
+  for (size_t i = 0; i < PARTICLES; ++i) {
+    const f32 vx = (rand()%2001-1000)/100000.f, vy = (rand()%2001-1000)/100000.f;
+    AddParticle(s_ps, 0.f, 0.f, vx, vy, -0.001f);
+  }
+
+  for (uptr i = 0; i < 4; ++i) s_quad.v[i].pos = VEC4((i&1)*0.01f, (i>>1)*0.01f, 0.5f, 0.f);
+
+  const int iterations = 200;
+  double u = Bench("update", Update, iterations);
+  double d = Bench("draw", Draw, iterations);
+  printf("Frame: %.1f us for %zu particles\n", (u+d)*1000000.0, PARTICLES);
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#include "loveylib/types.h"
+#include "loveylib/assert.h"
+#include "log.h"
+#include "str.h"
+#include "pack.h"
+#include "asset.h"
+
+#include <cstring>
+
+static const char * const S_KnownAssets[KNOWN_ASSET_COUNT] = {
+  "", // ASSET_NONE
+
+  "data/bgm/title.wav", // ASSET_TITLE_BGM
+  "data/bgm/world1.wav", // ASSET_WORLD1_BGM
+
+  "data/room/intro0.rm", // ASSET_INTRO0_ROOM
+  "data/room/11.rm", // ASSET_11_ROOM
+  "data/room/12.rm", // ASSET_12_ROOM
+  "data/room/13.rm", // ASSET_13_ROOM
+  "data/room/clear.rm", // ASSET_CLEAR_ROOM
+  "data/room/ending.rm", // ASSET_ENDING_ROOM
+};
+
+// Hash table size, a power of 2 so it's never more than half full
+static constexpr const uptr ASSET_TABLE_SIZE = MAX_ASSETS*2;
+
+static char s_names[MAX_ASSETS][ASSET_NAME_LENGTH];
+static u32 s_hashes[MAX_ASSETS];
+static uptr s_count = 1; // ASSET_NONE is never in the table
+
+// Hash table of IDs, ASSET_NONE marks an empty slot
+static asset_id_t s_table[ASSET_TABLE_SIZE];
+
+void InitAssets() {
+  for (uptr i = 1; i < KNOWN_ASSET_COUNT; ++i) {
+    const asset_id_t id = InternAsset(S_KnownAssets[i]);
+    ASSERT(id == i);
+    (void)id;
+  }
+}
+
+asset_id_t InternAsset(const char *name) {
+  if (!*name) return ASSET_NONE;
+
+  const u32 hash = HashAssetName(name);
+  uptr slot = hash&(ASSET_TABLE_SIZE-1);
+
+  for (; s_table[slot]; slot = (slot+1)&(ASSET_TABLE_SIZE-1)) {
+    const asset_id_t id = s_table[slot];
+    if ((s_hashes[id] == hash) && !strcmp(s_names[id], name)) return id;
+  }
+
+  if (s_count == MAX_ASSETS) LOG_ERROR("Too many assets!");
+  if (strlen(name) >= ASSET_NAME_LENGTH)
+    LOG_ERROR(FMT.s(name).s(" is too long an asset name!").STR);
+
+  const asset_id_t id = s_count++;
+  strcpy(s_names[id], name);
+  s_hashes[id] = hash;
+  s_table[slot] = id;
+
+  return id;
+}
+
+const char *GetAssetName(asset_id_t id) {
+  ASSERT(id < MAX_ASSETS);
+  return s_names[id];
+}
@@ -0,0 +1,88 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#ifndef _ASSET_H
+#define _ASSET_H
+
+#include "loveylib/types.h"
+
+/*
+ * Asset IDs
+ *
+ * Asset paths are interned into dense IDs, so they can be
+ * compared and used to index tables instead of strings.
+ * Assets the game refers to by name are interned first by
+ * InitAssets, in known_asset_e order, so their IDs are
+ * constants. Any other path, like a warp destination, gets
+ * the next ID the first time it's interned.
+ *
+ * IDs only last while the game is running, anything saved
+ * keeps the path. Only the game thread can intern paths,
+ * but GetAssetName can be called from any thread.
+ */
+
+typedef u16 asset_id_t;
+
+// Most assets that can be interned
+static constexpr const uptr MAX_ASSETS = 512;
+
+// Longest asset path, counting the terminator
+static constexpr const uptr ASSET_NAME_LENGTH = 64;
+
+// Screw you emacs
+#define known_asset_e known_asset_e : asset_id_t
+enum known_asset_e {
+  ASSET_NONE = 0, // ""
+
+  ASSET_TITLE_BGM,
+  ASSET_WORLD1_BGM,
+
+  ASSET_INTRO0_ROOM,
+  ASSET_11_ROOM,
+  ASSET_12_ROOM,
+  ASSET_13_ROOM,
+  ASSET_CLEAR_ROOM,
+  ASSET_ENDING_ROOM,
+
+  KNOWN_ASSET_COUNT
+};
+#undef known_asset_e
+
+// Intern known assets
+void InitAssets();
+
+// Get ID of asset path, interning it if it hasn't been seen
+// "" is always ASSET_NONE
+asset_id_t InternAsset(const char *name);
+
+// Get path of interned asset
+const char *GetAssetName(asset_id_t id);
+
+#endif //_ASSET_H
@@ -36,6 +36,7 @@
 #include "loveylib/endian.h"
 #include "loveylib_config.h"
 #include "log.h"
+#include "pack.h"
 
 #include <cstring>
 
@@ -164,15 +165,93 @@ static const i32 S_CoeffTable[7][2] = {
   {240, 0}, {460, -208}, {392, -232}
 };
 
+static_assert(sizeof(adpcm_block_t) == ADPCM_BLOCK_SIZE, "");
+
+// Blocks are read a chunk at a time, the next chunk is
+// read while the current one is decoded, so the audio
+// thread doesn't wait on the disk
+static constexpr const uptr ADPCM_CHUNK_BLOCKS = 32;
+static constexpr const uptr ADPCM_CHUNK_SIZE = ADPCM_CHUNK_BLOCKS*ADPCM_BLOCK_SIZE;
+
+struct adpcm_chunk_t {
+  async_read_t read;
+
+  // Bytes requested, always whole blocks
+  uptr size;
+
+  // Set if the chunk ends at the end of the block data
+  bfast last;
+
+  u8 data[ADPCM_CHUNK_SIZE];
+};
+
 static audio_frame_t s_sampleBuf[ADPCM_BLOCK_FRAMES];
 static uptr s_numSamples;
-static stream_t s_file;
+static asset_file_t s_file = {};
+
+// Block data in s_file.file
+static u64 s_dataStart, s_dataEnd;
+static u64 s_readOffset; // Offset of next chunk to read
+
+static adpcm_chunk_t s_chunks[2];
+static uptr s_curChunk; // Chunk being decoded
+static uptr s_chunkOffset; // Offset of next block in it
+
+// Start reading next chunk of block data
+// Wraps back to the first block after the last one
+static void ReadChunk(adpcm_chunk_t *c) {
+  c->size = ADPCM_CHUNK_SIZE;
+  if (s_dataEnd-s_readOffset < c->size) c->size = s_dataEnd-s_readOffset;
+
+  c->last = s_readOffset+c->size == s_dataEnd;
+
+  if (!SubmitRead(&c->read, s_file.file, c->data, c->size, s_readOffset)) {
+    // Too many reads in flight, read it now
+    c->read.result = ReadFileAt(s_file.file, c->data, c->size, s_readOffset);
+    c->read.done.store(1, std::memory_order_relaxed);
+  }
+
+  s_readOffset = c->last ? s_dataStart : s_readOffset+c->size;
+}
+
+// Wait for chunk, data that couldn't be read is silent
+static void WaitChunk(adpcm_chunk_t *c) {
+  iptr ret = WaitRead(&c->read);
+  if (ret < 0) ret = 0;
+
+  if ((uptr)ret < c->size) memset(c->data+ret, 0, c->size-ret);
+}
+
+// Get next block
+// Returns false after the last block, the
+// next call gets the first block again
+static bfast NextBlock(adpcm_block_t *out) {
+  adpcm_chunk_t *c = s_chunks+s_curChunk;
+
+  if (s_chunkOffset == c->size) {
+    const bfast last = c->last;
+
+    // Refill this chunk, and switch to the other one
+    ReadChunk(c);
+    s_curChunk ^= 1;
+    c = s_chunks+s_curChunk;
+
+    WaitChunk(c);
+    s_chunkOffset = 0;
+
+    if (last) return false;
+  }
+
+  memcpy(out, c->data+s_chunkOffset, sizeof(adpcm_block_t));
+  s_chunkOffset += sizeof(adpcm_block_t);
+
+  return true;
+}
 
 // Parse MS ADPCM block
 bfast ParseADPCM() {
   adpcm_block_t block;
-
-  if (s_file.f->read(&s_file, &block, sizeof(block)) < (iptr)sizeof(block)) return false;
+  if (!NextBlock(&block)) return false;
 
   block.swap();
 
@@ -232,18 +311,25 @@ bfast ParseADPCM() {
 }
 
 uptr OpenADPCM(const char *filename) {
-  s_file.init();
-  if (!OpenFile(&s_file, filename, FILE_READ_ONLY)) return 0;
+  if (!OpenAssetFile(&s_file, filename)) return 0;
 
   wave_hdr_t hdr;
 
-  if (s_file.f->read(&s_file, &hdr, sizeof(wave_hdr_t)) < (iptr)sizeof(wave_hdr_t)) {
-    CloseFile(&s_file);
+  if ((s_file.size < sizeof(wave_hdr_t)) ||
+      (ReadFileAt(s_file.file, &hdr, sizeof(wave_hdr_t), s_file.offset) != sizeof(wave_hdr_t)))
+  {
+    CloseAssetFile(&s_file);
     return 0;
   }
 
   hdr.swap();
 
+  // Only read blocks that are in the file, and have samples in them
+  uptr blocks = (s_file.size-sizeof(wave_hdr_t))/ADPCM_BLOCK_SIZE;
+  if (hdr.dataSize/ADPCM_BLOCK_SIZE < blocks) blocks = hdr.dataSize/ADPCM_BLOCK_SIZE;
+  if ((hdr.numSamples+ADPCM_BLOCK_FRAMES-1)/ADPCM_BLOCK_FRAMES < blocks)
+    blocks = (hdr.numSamples+ADPCM_BLOCK_FRAMES-1)/ADPCM_BLOCK_FRAMES;
+
   if ((hdr.riff != MAGIC('R', 'I', 'F', 'F')) ||
       (hdr.wave != MAGIC('W', 'A', 'V', 'E')) ||
       (hdr.fmt != MAGIC('f', 'm', 't', ' ')) ||
@@ -258,13 +344,24 @@ uptr OpenADPCM(const char *filename) {
       (hdr.numCoeffs != 7) ||
       (hdr.fact != MAGIC('f', 'a', 'c', 't')) ||
       (hdr.factSize != 4) ||
-      (hdr.data != MAGIC('d', 'a', 't', 'a')))
+      (hdr.data != MAGIC('d', 'a', 't', 'a')) ||
+      !blocks)
   {
     LOG_STATUS("Invalid ADPCM file!");
-    CloseFile(&s_file);
+    CloseAssetFile(&s_file);
     return 0;
   }
 
+  s_dataStart = s_readOffset = s_file.offset+sizeof(wave_hdr_t);
+  s_dataEnd = s_dataStart + blocks*ADPCM_BLOCK_SIZE;
+
+  // Keep both chunks in flight
+  ReadChunk(s_chunks);
+  ReadChunk(s_chunks+1);
+  s_curChunk = 0;
+  s_chunkOffset = 0;
+  WaitChunk(s_chunks);
+
   s_numSamples = hdr.numSamples;
   return s_numSamples;
 }
@@ -274,7 +371,12 @@ static uptr s_sampleBufPtr = ADPCM_BLOCK_FRAMES;
 void CloseADPCM() {
   s_sample = 0;
   s_sampleBufPtr = ADPCM_BLOCK_FRAMES; // Force next ReadADPCM to call ParseADPCM
-  CloseFile(&s_file);
+  if (!s_file.file) return;
+
+  // Chunks can't be read into after the file is closed
+  WaitRead(&s_chunks[0].read);
+  WaitRead(&s_chunks[1].read);
+  CloseAssetFile(&s_file);
 }
 
 static uptr ReadSamples(audio_frame_t *out, uptr frames) {
@@ -298,8 +400,9 @@ void ReadADPCM(audio_frame_t *out, uptr frames) {
       out += ret;
       frames -= ret;
       if (!ParseADPCM()) {
+        // Loop, the next block is the first one
         s_sample = 0;
-        s_file.f->seek(&s_file, sizeof(wave_hdr_t), ORIGIN_SET);
+        s_sampleBufPtr = ADPCM_BLOCK_FRAMES;
       }
     } else return;
   }
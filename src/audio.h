@@ -33,6 +33,7 @@
 
 #include "loveylib/types.h"
 #include "loveylib/stream.h"
+#include "asset.h"
 
 // Disable audio, for testing
 // Will replace all audio handling functions with NOPs
@@ -89,11 +90,11 @@ void FreeAudio();
 // Sound interface
 
 // Loops BGM
-// If filename is "", stops BGM
-// If filename couldn't be found, stops BGM
-// If filename is the same as the last call
+// If bgm is ASSET_NONE, stops BGM
+// If bgm couldn't be found, stops BGM
+// If bgm is the same as the last call
 // to this function, it is a NOP
-void PlayBGM(const char *filename);
+void PlayBGM(asset_id_t bgm);
 
 // Plays sound
 sound_handle_t PlaySound(sound_t snd);
@@ -115,7 +116,7 @@ void UpdateAudio();
 // Add 'a' to change prototype
 static inline void InitAudio(int a = 0) {(void)a;}
 static inline void FreeAudio(int a = 0) {(void)a;}
-static inline void PlayBGM(const char*, int a = 0) {(void)a;}
+static inline void PlayBGM(asset_id_t, int a = 0) {(void)a;}
 static inline sound_handle_t PlaySound(sound_t, int a = 0) {(void)a; return 0;}
 static inline void StopAllSounds(int a = 0) {(void)a;}
 static inline void StopSound(sound_t, int a = 0) {(void)a;}
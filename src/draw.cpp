@@ -36,18 +36,26 @@
 #include "loveylib/opengl.h"
 #include "loveylib/vector.h"
 #include "loveylib/file.h"
+#include "loveylib/heap.h"
+#include "loveylib/thread.h"
+#include "loveylib/job.h"
 #include "loveylib/assert.h"
 #include "loveylib_config.h"
 #include "mem.h"
 #include "log.h"
 #include "str.h"
 #include "draw.h"
+#include "page.h"
+#include "pack.h"
 
 #ifdef LOVEYLIB_APPLE
 #define APPLE_RENDER
 #include "plat/apple_render.h"
 #endif
 
+#include <atomic>
+#include <cstring>
+
 #ifndef APPLE_RENDER
 
 #ifndef NDEBUG
@@ -190,22 +198,126 @@ static constexpr const rquad_t S_Images[IMG_COUNT] = {
 #undef T_IMG
 #undef T_IMGROT
 
+// Number of bands the page streamer uploads each frame
+// while a page is being prefetched
+static constexpr const uptr PAGE_BANDS_PER_FRAME = 2;
+
+// Pages are uploaded in cells of 128x128 pixels, each row of
+// cells is one band
+static constexpr const uptr PAGE_CELL_SIZE = 128;
+static constexpr const uptr PAGE_CELLS_X = PAGE_WIDTH/PAGE_CELL_SIZE;
+static_assert(PAGE_CELL_SIZE == PAGE_BAND_HEIGHT, "");
+static_assert(PAGE_CELLS_X <= 16, "");
+static_assert(PAGE_BANDS == sizeof(page_cells_t::rows)/sizeof(u16), "");
+
+// Every cell of a page
+static constexpr const page_cells_t S_AllPageCells = {{
+  0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+  0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff
+}};
+
+// Compressed pages are read in chunks of this many words
+static constexpr const uptr PAGE_INPUT_WORDS = 16384;
+
+// Largest v2 page file, every band compressed as badly as possible
+static constexpr const uptr PAGE_MAX_FILE_SIZE = PAGE_TABLE_SIZE + PAGE_BAND_BOUND*PAGE_BANDS;
+
 #ifndef APPLE_RENDER
 
 // Renderer state
 static constexpr const uptr VBO_VERTS = 16384;
 static constexpr const uptr VBO_SIZE = sizeof(vertex_t)*VBO_VERTS;
 
+// Vertices in one frame, drawn VBO_VERTS at a time
+// Enough for 128k quads, 8MB per frame
+static constexpr const uptr FRAME_VERTS = VBO_VERTS*32;
+
 #define s_vbo s_buf[0]
 #define s_ebo s_buf[1]
 static gl::uint_t s_vao, s_buf[2];
 static gl::uint_t s_program;
-static gl::uint_t s_texture;
 
 static gl::funcs_t *s_gl;
 
-static vertex_t *s_vertBuf;
-static uptr s_vertCount; // <= VBO_VERTS
+// Maximum texture uploads in one frame
+static constexpr const uptr RENDER_MAX_UPLOADS = 128;
+
+// Texture upload, done by the renderer before it draws a frame
+struct render_upload_t {
+  const u32 *image; // Staging image, never changes once decoded
+  u16 cells; // Cells in row to upload
+  u8 row;
+  u8 tex; // Texture to upload to
+};
+
+// Render snapshot
+// Everything needed to draw a frame, written by the game thread
+// and read by the render thread once it's submitted
+struct render_frame_t {
+  vertex_t verts[FRAME_VERTS];
+  uptr vertCount; // <= FRAME_VERTS
+
+  render_upload_t uploads[RENDER_MAX_UPLOADS];
+  uptr uploadCount;
+
+  f32 clearColor[3];
+  ufast texture; // Texture to draw with
+};
+
+/*
+ * Renderer
+ *
+ * The render thread owns the OpenGL context. The game thread
+ * fills a frame while the render thread draws and presents the
+ * last one, so simulating frame N+1 overlaps with presenting
+ * frame N.
+ *
+ * If threads aren't available, frames are drawn and presented
+ * by the game thread in RenderGame.
+ */
+struct renderer_t {
+  thread_t thread;
+
+  // submit: Signalled when a frame is ready to draw
+  // free: Signalled when the render thread is done with a frame,
+  // counts frames free to fill, so it has to be a semaphore
+  semaphore_t submit, free;
+
+  canvas_t *canvas;
+
+  render_frame_t frames[2];
+  ufast cur; // Frame being filled by the game thread
+
+  bfast threaded;
+  volatile bfast failed;
+  volatile bfast quit;
+};
+
+static renderer_t s_renderer;
+
+// Clear color of following frames
+static f32 s_clearColor[3];
+
+// Get frame being filled by the game thread
+static inline render_frame_t *CurFrame() {
+  return s_renderer.frames+s_renderer.cur;
+}
+
+// Textures, the front texture is the one being drawn with
+static gl::uint_t s_textures[2];
+static page_t s_texPage[2]; // Page in each texture, -1 if none
+static page_cells_t s_texCells[2]; // Cells uploaded to each texture
+static ufast s_frontTexture;
+
+// Cells of the images drawn in almost every room, uploaded
+// with every page
+static page_cells_t s_commonCells;
+
+// Page and cells of each texture as of the last frame handed
+// to the renderer, page is -1 if the texture has been streamed
+// into since
+static page_t s_submittedPage[2];
+static page_cells_t s_submittedCells[2];
 
 #endif  //ifndef APPLE_RENDER
 
@@ -296,9 +408,9 @@ static bfast InitProgram() {
   return true;
 }
 
-// Allocate & initialize local index buffer
+// Allocate & initialize local index buffer in scratch memory
 u16 *AllocIndexBuffer() {
-  u16 *ret = (u16*)Alloc((VBO_VERTS>>2)*12);
+  u16 *ret = (u16*)ScratchAlloc((VBO_VERTS>>2)*12, "Index buffer");
 
   u32 v = 0;
   for (uptr i = 0; i < (VBO_VERTS>>2)*6; i += 6, v += 4) {
@@ -322,10 +434,13 @@ static void InitBuffers() {
   GLF(BindBuffer(gl::ARRAY_BUFFER, s_vbo));
   GLF(BufferData(gl::ARRAY_BUFFER, VBO_SIZE, NULL, gl::STREAM_DRAW));
 
-  u16 *indBuf = (u16*)AllocIndexBuffer();
-  GLF(BindBuffer(gl::ELEMENT_ARRAY_BUFFER, s_ebo));
-  GLF(BufferData(gl::ELEMENT_ARRAY_BUFFER, (VBO_VERTS>>2)*12, indBuf, gl::STATIC_DRAW));
-  Free(indBuf);
+  {
+    scratch_scope_t scope;
+
+    u16 *indBuf = (u16*)AllocIndexBuffer();
+    GLF(BindBuffer(gl::ELEMENT_ARRAY_BUFFER, s_ebo));
+    GLF(BufferData(gl::ELEMENT_ARRAY_BUFFER, (VBO_VERTS>>2)*12, indBuf, gl::STATIC_DRAW));
+  }
 
   // Setup vertex buffer attributes
   GLF(VertexAttribPointer(0, 3, gl::FLOAT, false, sizeof(vertex_t), NULL));
@@ -335,245 +450,831 @@ static void InitBuffers() {
   GLF(EnableVertexAttribArray(1));
 }
 
-// Initialize texture
-static void InitTexture() {
-  GLF(GenTextures(1, &s_texture));
-  GLF(BindTexture(gl::TEXTURE_2D, s_texture));
+// Initialize textures
+static void InitTextures() {
+  GLF(GenTextures(2, s_textures));
+
+  for (uptr i = 0; i < 2; ++i) {
+    GLF(BindTexture(gl::TEXTURE_2D, s_textures[i]));
+
+    // Make 2048x2048 RGBA8 texture
+    GLF(TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA8, PAGE_WIDTH, PAGE_HEIGHT, 0,
+                   gl::BGRA, gl::UNSIGNED_BYTE, NULL));
 
-  // Make 2048x2048 RGBA8 texture
-  GLF(TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA8, 2048, 2048, 0,
-                 gl::BGRA, gl::UNSIGNED_BYTE, NULL));
+    // Clamp coordinates to edge
+    GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE));
+    GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE));
 
-  // Clamp coordinates to edge
-  GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_S, gl::CLAMP_TO_EDGE));
-  GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_WRAP_T, gl::CLAMP_TO_EDGE));
+    // No mipmap levels defined
+    GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAX_LEVEL, 0));
 
-  // No mipmap levels defined
-  GLF(TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAX_LEVEL, 0));
+    // No page in texture yet
+    s_texPage[i] = s_submittedPage[i] = -1;
+    s_texCells[i] = {};
+  }
+
+  // Cells are uploaded straight from the staging image
+  GLF(PixelStorei(gl::UNPACK_ROW_LENGTH, PAGE_WIDTH));
+
+  // The player, bullets, saves and warps
+  s_commonCells = {};
+  MarkPageCells(&s_commonCells, S_Images, IMG_GAMEOVER);
+
+  s_frontTexture = 0;
+  GLF(BindTexture(gl::TEXTURE_2D, s_textures[s_frontTexture]));
+}
+
+// Upload cells of a staging image into the bound texture
+static void SubmitPageCells(const render_upload_t *u) {
+  const u32 y = u->row*PAGE_CELL_SIZE;
+
+  // Upload runs of adjacent cells together
+  for (uptr x = 0; x < PAGE_CELLS_X;) {
+    if (!(u->cells & (1<<x))) {
+      ++x;
+      continue;
+    }
+
+    uptr end = x+1;
+    while ((end < PAGE_CELLS_X) && (u->cells & (1<<end))) ++end;
+
+    GLF(TexSubImage2D(gl::TEXTURE_2D, 0, x*PAGE_CELL_SIZE, y,
+                      (end-x)*PAGE_CELL_SIZE, PAGE_CELL_SIZE,
+                      gl::BGRA, gl::UNSIGNED_BYTE, u->image + y*PAGE_WIDTH + x*PAGE_CELL_SIZE));
+    x = end;
+  }
 }
 
-// Orphan & map s_vertBuf, if required
-static void OrphanVertBuf() {
-  // Orphan & map buffer, if necessary
-  if (!s_vertBuf) {
+// Draw frame
+static void SubmitFrame(const render_frame_t *f) {
+  // Upload textures
+  for (uptr i = 0; i < f->uploadCount; ++i) {
+    const render_upload_t *u = f->uploads+i;
+
+    if (!i || (u->tex != f->uploads[i-1].tex)) {
+      GLF(BindTexture(gl::TEXTURE_2D, s_textures[u->tex]));
+    }
+    SubmitPageCells(u);
+  }
+
+  GLF(BindTexture(gl::TEXTURE_2D, s_textures[f->texture]));
+
+  GLF(ClearColor(f->clearColor[0], f->clearColor[1], f->clearColor[2], 1.f));
+  GLF(Clear(gl::COLOR_BUFFER_BIT|gl::DEPTH_BUFFER_BIT));
+
+  // Draw a vertex buffer at a time, orphaning it before
+  // each fill
+  for (uptr first = 0; first < f->vertCount; first += VBO_VERTS) {
+    const uptr count = (f->vertCount-first < VBO_VERTS) ? f->vertCount-first : VBO_VERTS;
+
     GLF(BufferData(gl::ARRAY_BUFFER, VBO_SIZE, NULL, gl::STREAM_DRAW));
-    s_vertBuf = (vertex_t*)GLF(MapBufferRange(gl::ARRAY_BUFFER, 0, VBO_SIZE,
-                                            gl::MAP_WRITE_BIT|gl::MAP_UNSYNCHRONIZED_BIT));
+    GLF(BufferSubData(gl::ARRAY_BUFFER, 0, count*sizeof(vertex_t), f->verts+first));
+    GLF(DrawElements(gl::TRIANGLES, (count>>2)*6, gl::UNSIGNED_SHORT, NULL));
   }
 }
 
-#endif  //ifndef APPLE_RENDER
+// Render thread entry point
+static void RenderThreadMain(void *data) {
+  renderer_t *r = (renderer_t*)data;
 
-// Create OpenGL window
-void CreateWindow(canvas_t *out, const char *title) {
-  // Apple usees its own window implementation, so all CreateWindow has to do is
-  // initialize the renderer.
-#ifndef APPLE_RENDER
-  if (!CreateOpenGLCanvas(out, title, GAME_WIDTH, GAME_HEIGHT))
-    LOG_ERROR("Cannot create OpenGL canvas!");
+  // Take OpenGL context, tell the game thread if we couldn't
+  r->failed = !BindOpenGLCanvas(r->canvas, true);
+  SignalSema(&r->free);
+  if (r->failed) return;
 
-  s_gl = &out->c.gl.f;
+  // Frames are submitted in order
+  for (ufast cur = 0;; cur ^= 1) {
+    WaitSema(&r->submit);
+    if (r->quit) break;
 
-  if (!InitProgram())
-    LOG_ERROR("Cannot create shader program!");
+    SubmitFrame(r->frames+cur);
+    RenderCanvas(r->canvas);
 
-  InitBuffers();
-  InitTexture();
+    SignalSema(&r->free);
+  }
 
-  GLF(UseProgram(s_program));
+  BindOpenGLCanvas(r->canvas, false);
+}
 
-  // Map vertex buffer when necessary
-  s_vertBuf = NULL;
-  s_vertCount = 0;
-#else   //ifndef APPLE_RENDER
-  (void)out; (void)title;
-#endif  //ifdef APPLE_RENDER
+// Start render thread, handing it the OpenGL context
+static void InitRenderer(renderer_t *r, canvas_t *canvas) {
+  r->canvas = canvas;
+  r->cur = 0;
+  r->frames[0].vertCount = r->frames[0].uploadCount = 0;
+  r->quit = false;
+
+  // Fall back to rendering on the game thread if
+  // there's no thread support
+  r->threaded = false;
+  if (CreateSema(&r->submit)) {
+    if (CreateSema(&r->free)) {
+      if (BindOpenGLCanvas(canvas, false)) {
+        thread_attr_t attr = {};
+        attr.priority = THREAD_PRIO_HIGH;
+        attr.name = "Render";
+
+        if (CreateThread(&r->thread, RenderThreadMain, r, &attr)) {
+          // Wait for the render thread to take the context
+          WaitSema(&r->free);
+          if (!r->failed) {
+            // The other frame is free to fill
+            SignalSema(&r->free);
+            r->threaded = true;
+            return;
+          }
+
+          WaitThread(&r->thread);
+          DestroyThread(&r->thread);
+        }
+
+        if (!BindOpenGLCanvas(canvas, true))
+          LOG_ERROR("Cannot bind OpenGL context!");
+      }
+
+      DestroySema(&r->free);
+    }
+
+    DestroySema(&r->submit);
+  }
 
-  // No page is currently active
-  s_curPage = -1;
+  LOG_INFO("Renderer isn't threaded");
+}
 
-#ifndef APPLE_RENDER
-  // Enable alpha blending
-//  GLF(Enable(gl::BLEND));
-//  GLF(BlendFunc(gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA));
+// Stop render thread, taking back the OpenGL context
+static void FreeRenderer(renderer_t *r) {
+  if (!r->threaded) return;
 
-  // Enable depth test
-  GLF(Enable(gl::DEPTH_TEST));
-  GLF(DepthFunc(gl::LESS));
-  GLF(DepthRange(0.f, 1.f));
+  // Finish the frame being drawn, if any
+  WaitSema(&r->free);
+
+  r->quit = true;
+  SignalSema(&r->submit);
+  WaitThread(&r->thread);
+  DestroyThread(&r->thread);
+
+  DestroySema(&r->submit);
+  DestroySema(&r->free);
+
+  if (!BindOpenGLCanvas(r->canvas, true))
+    LOG_ERROR("Cannot bind OpenGL context!");
+}
 
-  // Enable scissor test
-  GLF(Enable(gl::SCISSOR_TEST));
 #endif  //ifndef APPLE_RENDER
 
-  // Set default clear color
-  SetClearColor(0.f, 0.f, 0.f);
+/*
+ * Page streamer
+ *
+ * Pages are decoded into a staging image on a worker thread,
+ * band by band. The game thread uploads finished bands into
+ * the back texture, a few bands a frame, and SetPage swaps
+ * the back texture to the front once the whole page is in.
+ *
+ * Only the cells a room asks for are uploaded with the page,
+ * the rest are uploaded the first time they're drawn. Each
+ * page has it's own staging image, allocated the first time
+ * the page is streamed and kept once it's decoded, so cells
+ * can be uploaded at any time. Once every cell in a band is
+ * in the page's texture, the band's memory is given back to
+ * the OS, and once every band is, the image is freed.
+ *
+ * v2 pages ("data/page/Nz") are mapped whole, and their bands
+ * are decoded in parallel as jobs, each band is uploaded as
+ * soon as it's ready. Older pages are decoded in order by
+ * the streamer alone.
+ *
+ * If threads aren't available, pages are decoded on the
+ * calling thread instead.
+ */
+struct page_streamer_t {
+  thread_t thread;
+
+  // request: Signalled when a page should be decoded
+  // done: Signalled when the requested page is decoded
+  semaphore_t request, done;
+
+  // 2048x2048 BGRA8 staging image of each page, in their own heaps,
+  // NULL until the page is first streamed
+  u32 *images[NUM_PAGES];
+
+  // Set once a page is completely decoded into it's image,
+  // and cleared once any of the image is given back, only used
+  // by the game thread
+  bfast decoded[NUM_PAGES];
+
+  // Bands of each staging image given back to the OS, only
+  // used by the game thread
+  u16 bandsReleased[NUM_PAGES];
+
+  // Page being streamed and it's staging image, page is
+  // -1 if the streamer is idle
+  page_t page;
+  u32 *pixels;
+
+  // Cells to upload to the back texture
+  page_cells_t cells;
+
+  // Set if the streamer thread is decoding the page,
+  // and done hasn't been consumed
+  bfast decoding;
+
+  // Set for each band decoded into the staging image
+  std::atomic<bfast> bandReady[PAGE_BANDS];
+
+  // Number of bands decoded, the thread that decodes the
+  // last band signals done
+  std::atomic<uptr> bandsDone;
+
+  // Set if the requested page couldn't be loaded
+  std::atomic<bfast> failed;
+
+  // Bands uploaded, only used by the game thread
+  bfast bandUploaded[PAGE_BANDS];
+  uptr bandsUploaded;
+
+  bfast threaded;
+  volatile bfast quit;
+
+#ifdef COMPRESS_TEXTURES
+  rle_decoder_t rle;
+  u32 input[PAGE_INPUT_WORDS];
+
+  // v2 page file, mapped while it's bands are decoded
+  const u8 *file;
+  page_band_t bands[PAGE_BANDS];
+#endif
+};
+
+static page_streamer_t s_streamer;
+
+// Mark band as decoded
+static void PublishPageBand(page_streamer_t *s, uptr band) {
+  s->bandReady[band].store(true, std::memory_order_release);
+
+  if ((s->bandsDone.fetch_add(1, std::memory_order_acq_rel)+1 == PAGE_BANDS) && s->threaded)
+    SignalSema(&s->done);
 }
 
-// Close OpenGL window, freeing any OpenGL resources along the way
-void CloseWindow(canvas_t *c) {
-  // Apple uses its own window implementation, so all CloseWindow has to do is
-  // shut down the renderer.
-#ifndef APPLE_RENDER
-  GLF(DeleteTextures(1, &s_texture));
-  GLF(BindBuffer(gl::ELEMENT_ARRAY_BUFFER, 0));
-  GLF(BindBuffer(gl::ARRAY_BUFFER, 0));
-  GLF(BindVertexArray(0));
-  GLF(DeleteBuffers(2, s_buf));
-  GLF(DeleteVertexArrays(1, &s_vao));
-  GLF(DeleteProgram(s_program));
+// Fail page, marking every band that isn't decoded yet
+// as decoded, bands is the number decoded so far
+static void FailPage(page_streamer_t *s, uptr bands) {
+  s->failed.store(true, std::memory_order_relaxed);
+  for (uptr band = bands; band < PAGE_BANDS; ++band)
+    PublishPageBand(s, band);
+}
 
-  CloseCanvas(c);
-#else   //ifndef APPLE_RENDER
-  (void)c;
-#endif  //ifdef APPLE_RENDER
+#ifdef COMPRESS_TEXTURES
+
+// Read next chunk of compressed input from the page file
+// Returns false if the file has no more input
+static bfast ReadPageInput(page_streamer_t *s, stream_t *f) {
+  // Keep whatever the decoder didn't consume
+  const uptr left = RLEInputLeft(&s->rle);
+  if (left) memmove(s->input, s->rle.in, left*4);
+
+  const iptr ret = f->f->read(f, s->input+left, (PAGE_INPUT_WORDS-left)*4);
+  if (ret < 4) return false;
+
+  FeedRLEDecoder(&s->rle, s->input, left+ret/4);
+  return true;
 }
 
-#ifndef COMPRESS_TEXTURES
+// Decode v2 bands [begin, end), ParallelFor entry point
+static void DecodePageBands(void *data, uptr begin, uptr end) {
+  page_streamer_t *s = (page_streamer_t*)data;
 
-// Set image page
-void SetPage(page_t p) {
-  if (s_curPage == p) return;
-  s_curPage = p;
+  for (uptr band = begin; band < end; ++band) {
+    const page_band_t *b = s->bands+band;
+    u32 * const out = s->pixels + band*PAGE_BAND_PIXELS;
+
+    if (!DecodePageBand(s->file+b->offset, b->size, out)) {
+      memset(out, 0, PAGE_BAND_PIXELS*4);
+      s->failed.store(true, std::memory_order_relaxed);
+    }
 
-  // Read 2048x2048 BGRA8 image into ram, fragment write if need be
-  uptr curHeight = 4096; // Divided by 2 in loop
-  void *imageData;
+    PublishPageBand(s, band);
+  }
+}
+
+// Decode requested page from it's v2 file
+// Returns false if there's no v2 file for the page
+static bfast DecodePageV2(page_streamer_t *s) {
+  char filename[13] = "data/page/ z";
+  filename[10] = s->page+'0';
+
+  mapped_file_t file;
+  if (!MapAsset(&file, filename)) return false;
+
+  if (!file.size || (file.size > PAGE_MAX_FILE_SIZE) ||
+      !ReadPageTable(file.data, file.size, s->bands))
+  {
+    UnmapAsset(&file);
+    FailPage(s, 0);
+    return true;
+  }
+
+  // Bands are decoded straight out of the mapping, queueing the
+  // ParallelFor jobs publishes file and bands to the workers, and
+  // PublishPageBand publishes each band to the game thread
+  s->file = file.data;
+  ParallelFor(PAGE_BANDS, 1, DecodePageBands, s);
+
+  s->file = NULL;
+  UnmapAsset(&file);
+  return true;
+}
+
+#endif //COMPRESS_TEXTURES
+
+// Decode requested page into the staging image
+static void DecodePage(page_streamer_t *s) {
+#ifndef COMPRESS_TEXTURES
   char filename[12] = "data/page/ ";
-  filename[10] = p+'0';
+#else
+  if (DecodePageV2(s)) return;
 
-  ASSERT(p < NUM_PAGES);
+  char filename[13] = "data/page/ c";
+#endif
+  filename[10] = s->page+'0';
 
   // Open input page file
+  mapped_file_t file;
+  if (!MapAsset(&file, filename)) {
+    FailPage(s, 0);
+    return;
+  }
+
   stream_t f;
-  f.init();
-  if (!OpenFile(&f, filename, FILE_READ_ONLY))
-    LOG_ERROR(FMT.s("Couldn't open \"").s(filename).s("\"!").STR);
+  OpenMemoryStream(&f, file.data, file.size);
+
+#ifdef COMPRESS_TEXTURES
+  InitRLEDecoder(&s->rle);
+  bfast eof = false;
+#endif
 
-  do {
-    curHeight >>= 1;
-    LOG_INFO(FMT.s("Fragmenting down to ").i(curHeight).STR);
-    imageData = Alloc(2048*4*curHeight);
-  } while (!imageData);
+  for (uptr band = 0; band < PAGE_BANDS; ++band) {
+    u32 * const out = s->pixels + band*PAGE_BAND_PIXELS;
 
-  ASSERT(curHeight > 0);
+#ifndef COMPRESS_TEXTURES
+    f.f->read(&f, out, PAGE_BAND_PIXELS*4);
+#else
+    uptr written = 0;
+    for (;;) {
+      written += DecodeRLE(&s->rle, out+written, PAGE_BAND_PIXELS-written);
+      if (written == PAGE_BAND_PIXELS) break;
+
+      // Truncated page, clear the rest of it
+      if (eof || !ReadPageInput(s, &f)) {
+        memset(out+written, 0, (PAGE_BAND_PIXELS-written)*4);
+        eof = true;
+        break;
+      }
+    }
+#endif
 
-  u32 curY = 0;
-  while (curY < 2048) {
-    f.f->read(&f, imageData, 2048*4*curHeight);
-    GLF(TexSubImage2D(gl::TEXTURE_2D, 0, 0, curY, 2048, curHeight,
-                      gl::BGRA, gl::UNSIGNED_BYTE, imageData));
-    curY += curHeight;
+    PublishPageBand(s, band);
   }
 
-  Free(imageData);
-  CloseFile(&f);
+  UnmapAsset(&file);
 }
 
-#else //COMPRESS_TEXTURES
+// Page streamer thread entry point
+static void PageStreamerMain(void *data) {
+  page_streamer_t *s = (page_streamer_t*)data;
+
+  for (;;) {
+    WaitSema(&s->request);
+    if (s->quit) return;
 
-static inline bfast IsMarker(u32 pixel) {
-  return (pixel&CBIG_ENDIAN32(0xff)) == CBIG_ENDIAN32(0x80);
+    DecodePage(s);
+  }
 }
 
-static inline u32 MarkerLength(u32 marker) {
-  return LittleEndian32(marker)&0xffffff;
+// Initialize page streamer
+static void InitPageStreamer(page_streamer_t *s) {
+  for (page_t p = 0; p < NUM_PAGES; ++p) {
+    s->images[p] = NULL;
+    s->decoded[p] = false;
+    s->bandsReleased[p] = 0;
+  }
+
+#ifdef COMPRESS_TEXTURES
+  s->file = NULL;
+#endif
+
+  s->page = -1;
+  s->pixels = NULL;
+  s->decoding = false;
+  s->bandsDone.store(0, std::memory_order_relaxed);
+  s->failed.store(false, std::memory_order_relaxed);
+  s->bandsUploaded = 0;
+  s->quit = false;
+
+  // Fall back to decoding on the calling thread if
+  // there's no thread support
+  s->threaded = false;
+  if (CreateSema(&s->request)) {
+    if (CreateSema(&s->done)) {
+      thread_attr_t attr = {};
+      attr.name = "Page streamer";
+
+      if (CreateThread(&s->thread, PageStreamerMain, s, &attr)) {
+        s->threaded = true;
+        return;
+      }
+
+      DestroySema(&s->done);
+    }
+
+    DestroySema(&s->request);
+  }
+
+  LOG_INFO("Page streamer isn't threaded");
 }
 
-struct decompress_state_t {
-  u32 repCnt; // 0 == not repeating
-  u32 curPixel;
-  stream_t *file;
+// Free page streamer
+static void FreePageStreamer(page_streamer_t *s) {
+  if (s->threaded) {
+    // Let the streamer finish what it's doing
+    if (s->decoding) WaitSema(&s->done);
 
-  #define PIXEL_CACHE_SIZE 4096
-  u32 pixelCache[PIXEL_CACHE_SIZE];
-  uptr pixelCacheCursor;
-};
+    s->quit = true;
+    SignalSema(&s->request);
+    WaitThread(&s->thread);
+    DestroyThread(&s->thread);
 
-static void InitDecompression(stream_t *f, decompress_state_t *state) {
-  state->repCnt = 0;
-  state->file = f;
-  state->pixelCacheCursor = PIXEL_CACHE_SIZE-1;
+    DestroySema(&s->request);
+    DestroySema(&s->done);
+  }
+
+  for (page_t p = 0; p < NUM_PAGES; ++p)
+    if (s->images[p]) DestroyHeap(s->images[p]);
 }
 
-static u32 ReadPixel(decompress_state_t *state) {
-  if (state->pixelCacheCursor < PIXEL_CACHE_SIZE-1) {
-    return state->pixelCache[++state->pixelCacheCursor];
+// Upload cells in one row of a staging image into texture tex
+static void UploadPageCells(ufast tex, const u32 *image, uptr row, u16 cells) {
+#ifndef APPLE_RENDER
+  // The renderer uploads them before drawing the frame
+  render_frame_t *f = CurFrame();
+  ASSERT(f->uploadCount < RENDER_MAX_UPLOADS);
+
+  render_upload_t *u = f->uploads + f->uploadCount++;
+  u->image = image;
+  u->cells = cells;
+  u->row = row;
+  u->tex = tex;
+#else
+  // The apple renderer only has one texture, and always
+  // uploads whole bands
+  (void)tex, (void)cells;
+  const u32 y = row*PAGE_BAND_HEIGHT;
+  AppleLoadTexturePart(image+row*PAGE_BAND_PIXELS, 0, y, PAGE_WIDTH, y+PAGE_BAND_HEIGHT);
+#endif
+}
+
+// Start streaming page into the back texture
+static void StartPageStream(page_streamer_t *s, page_t p, const page_cells_t *cells) {
+  ASSERT(s->page < 0);
+  ASSERT(p < NUM_PAGES);
+
+  if (!s->images[p]) {
+    s->images[p] = (u32*)InitHeap(PAGE_WIDTH*PAGE_HEIGHT*4, HEAP_HUGE_PAGES_BIT);
+    if (!s->images[p]) LOG_ERROR("Cannot allocate page staging image!");
   }
 
-  state->file->f->read(state->file, state->pixelCache, sizeof(state->pixelCache));
-  state->pixelCacheCursor = 0;
-  return state->pixelCache[0];
+  s->page = p;
+  s->pixels = s->images[p];
+  s->cells = *cells;
+
+  for (uptr band = 0; band < PAGE_BANDS; ++band)
+    s->bandUploaded[band] = false;
+  s->bandsUploaded = 0;
+  s->failed.store(false, std::memory_order_relaxed);
+
+#ifndef APPLE_RENDER
+  // Back texture is incomplete until the page is done
+  s_texPage[s_frontTexture^1] = -1;
+  s_submittedPage[s_frontTexture^1] = -1;
+  s_texCells[s_frontTexture^1] = {};
+#endif
+
+  // Page is already in it's staging image, only upload it
+  if (s->decoded[p]) {
+    for (uptr band = 0; band < PAGE_BANDS; ++band)
+      s->bandReady[band].store(true, std::memory_order_relaxed);
+    s->bandsDone.store(PAGE_BANDS, std::memory_order_relaxed);
+    return;
+  }
+
+  for (uptr band = 0; band < PAGE_BANDS; ++band)
+    s->bandReady[band].store(false, std::memory_order_relaxed);
+  s->bandsDone.store(0, std::memory_order_relaxed);
+  s->bandsReleased[p] = 0;
+
+  s->decoding = s->threaded;
+  if (s->threaded) SignalSema(&s->request);
+  else DecodePage(s);
 }
 
-static u32 WritePixel(decompress_state_t *state) {
-  if (state->repCnt) {
-    --state->repCnt;
-    return state->curPixel;
+// Upload decoded bands, up to maxBands
+// If wait is set, block until the page is completely uploaded
+// Returns true if the streamer has finished the page
+static bfast PumpPageStream(page_streamer_t *s, uptr maxBands, bfast wait) {
+  if (s->page < 0) return true;
+
+  // Wait for the decoder to finish
+  if (wait && s->decoding) {
+    WaitSema(&s->done);
+    s->decoding = false;
+  }
+
+  for (uptr band = 0; (band < PAGE_BANDS) && maxBands; ++band) {
+    if (s->bandUploaded[band] || !s->bandReady[band].load(std::memory_order_acquire))
+      continue;
+
+    s->bandUploaded[band] = true;
+    ++s->bandsUploaded;
+
+    // Skip bands without any cells to upload
+    if (!s->cells.rows[band]) continue;
+
+#ifndef APPLE_RENDER
+    UploadPageCells(s_frontTexture^1, s->pixels, band, s->cells.rows[band]);
+#else
+    UploadPageCells(0, s->pixels, band, s->cells.rows[band]);
+#endif
+    --maxBands;
   }
 
-  // Read pixel from file, check if it's an RLE marker
-  u32 ret = ReadPixel(state);
-  if (IsMarker(ret)) {
-    state->repCnt = MarkerLength(ret);
-    state->curPixel = ReadPixel(state);
-    return state->curPixel;
+  if (s->bandsUploaded < PAGE_BANDS) return false;
+
+  if (s->failed.load(std::memory_order_relaxed))
+    LOG_ERROR(FMT.s("Couldn't load page ").i(s->page).s("!").STR);
+
+  // Consume done signal if we didn't wait for it
+  if (s->decoding) {
+    WaitSema(&s->done);
+    s->decoding = false;
   }
 
-  return ret;
+  s->decoded[s->page] = true;
+
+#ifndef APPLE_RENDER
+  s_texPage[s_frontTexture^1] = s->page;
+  s_texCells[s_frontTexture^1] = s->cells;
+#endif
+
+  s->page = -1;
+  return true;
+}
+
+#ifndef APPLE_RENDER
+
+// Upload cells that aren't in texture yet
+// The texture's page must be decoded
+static void RequirePageCells(ufast tex, const page_cells_t *cells) {
+  const u32 * const image = s_streamer.images[s_texPage[tex]];
+
+  for (uptr row = 0; row < PAGE_BANDS; ++row) {
+    const u16 missing = cells->rows[row] & ~s_texCells[tex].rows[row];
+    if (!missing) continue;
+
+    // Only bands with every cell uploaded are given back
+    ASSERT(image && !(s_streamer.bandsReleased[s_texPage[tex]] & (1u<<row)));
+    UploadPageCells(tex, image, row, missing);
+    s_texCells[tex].rows[row] |= missing;
+  }
+}
+
+// Remember what's in each texture, once the renderer is done
+// with the frame that was just submitted, it's all uploaded
+static void MarkSubmittedCells() {
+  for (uptr tex = 0; tex < 2; ++tex) {
+    s_submittedPage[tex] = s_texPage[tex];
+    s_submittedCells[tex] = s_texCells[tex];
+  }
+}
+
+// Give back bands of staging images whose cells were all
+// uploaded by frames the renderer is done with
+static void ReleasePageBands(page_streamer_t *s) {
+  for (uptr tex = 0; tex < 2; ++tex) {
+    const page_t p = s_submittedPage[tex];
+    if ((p < 0) || !s->images[p]) continue;
+
+    for (uptr row = 0; row < PAGE_BANDS; ++row) {
+      if ((s_submittedCells[tex].rows[row] != 0xffff) || (s->bandsReleased[p] & (1u<<row)))
+        continue;
+
+      ResetHeap(s->images[p], row*PAGE_BAND_PIXELS*4, PAGE_BAND_PIXELS*4);
+      s->bandsReleased[p] |= 1u<<row;
+      s->decoded[p] = false;
+    }
+
+    if (s->bandsReleased[p] == 0xffff) {
+      DestroyHeap(s->images[p]);
+      s->images[p] = NULL;
+    }
+  }
+}
+
+// Get range of cells covered by quad's texture coordinates
+static inline void QuadCellRange(const rquad_t *q, uptr *x0, uptr *y0, uptr *x1, uptr *y1) {
+  uptr left = q->v[0].coord.x, right = left;
+  uptr top = q->v[0].coord.y, bottom = top;
+
+  for (uptr i = 1; i < 4; ++i) {
+    const uptr s = q->v[i].coord.x, t = q->v[i].coord.y;
+    if (s < left) left = s;
+    if (s > right) right = s;
+    if (t < top) top = t;
+    if (t > bottom) bottom = t;
+  }
+
+  // Right and bottom edges aren't sampled
+  if (right > left) --right;
+  if (bottom > top) --bottom;
+
+  if (right >= PAGE_WIDTH) right = PAGE_WIDTH-1;
+  if (bottom >= PAGE_HEIGHT) bottom = PAGE_HEIGHT-1;
+  if (left > right) left = right;
+  if (top > bottom) top = bottom;
+
+  *x0 = left/PAGE_CELL_SIZE, *x1 = right/PAGE_CELL_SIZE;
+  *y0 = top/PAGE_CELL_SIZE, *y1 = bottom/PAGE_CELL_SIZE;
+}
+
+// Get mask of cells x0 to x1 in a row
+static inline u16 CellRowMask(uptr x0, uptr x1) {
+  return (u16)(((2u<<x1)-1) & ~((1u<<x0)-1));
+}
+
+// Upload any cells quads draw that aren't in the front texture yet
+static void RequireQuadCells(const rquad_t *quads, uptr quadCount) {
+  if (s_texPage[s_frontTexture] < 0) return;
+
+  const page_cells_t *resident = s_texCells+s_frontTexture;
+
+  for (uptr i = 0; i < quadCount; ++i) {
+    uptr x0, y0, x1, y1;
+    QuadCellRange(quads+i, &x0, &y0, &x1, &y1);
+
+    const u16 mask = CellRowMask(x0, x1);
+    for (uptr y = y0; y <= y1; ++y) {
+      if ((resident->rows[y] & mask) == mask) continue;
+
+      // Upload every missing cell the remaining quads draw at once
+      page_cells_t cells = {};
+      MarkPageCells(&cells, quads+i, quadCount-i);
+      RequirePageCells(s_frontTexture, &cells);
+      return;
+    }
+  }
+}
+
+#endif //ifndef APPLE_RENDER
+
+// Add cells covered by quads' texture coordinates to cells
+void MarkPageCells(page_cells_t *cells, const rquad_t *quads, uptr quadCount) {
+#ifndef APPLE_RENDER
+  for (uptr i = 0; i < quadCount; ++i) {
+    uptr x0, y0, x1, y1;
+    QuadCellRange(quads+i, &x0, &y0, &x1, &y1);
+
+    const u16 mask = CellRowMask(x0, x1);
+    for (uptr y = y0; y <= y1; ++y) cells->rows[y] |= mask;
+  }
+#else
+  // The apple renderer always uploads whole pages
+  (void)quads; (void)quadCount;
+  *cells = S_AllPageCells;
+#endif
+}
+
+// Prefetch image page into the back texture
+void PrefetchPage(page_t p) {
+#ifndef APPLE_RENDER
+  ASSERT(p < NUM_PAGES);
+
+  // Don't interrupt a page that's already streaming
+  if ((s_curPage == p) || (s_streamer.page >= 0) ||
+      (s_texPage[s_frontTexture^1] == p))
+    return;
+
+  StartPageStream(&s_streamer, p, &s_commonCells);
+#else
+  // The apple renderer only has one texture
+  (void)p;
+#endif
 }
 
 // Set image page
-void SetPage(page_t p) {
+void SetPage(page_t p, const page_cells_t *cells) {
   if (s_curPage == p) return;
   s_curPage = p;
 
-  // Read 2048x2048 BGRA8 image into ram, fragment write if need be
-  uptr curHeight = 4096; // Divided by 2 in loop
-  u32 *imageData;
-  char filename[13] = "data/page/ c";
-  filename[10] = p+'0';
-
   ASSERT(p < NUM_PAGES);
 
-  // Open input page file
-  stream_t f;
-  f.init();
-  if (!OpenFile(&f, filename, FILE_READ_ONLY))
-    LOG_ERROR(FMT.s("Couldn't open \"").s(filename).s("\"!").STR);
+#ifndef APPLE_RENDER
+  // Cells to upload up front
+  page_cells_t want = S_AllPageCells;
+  if (cells) {
+    for (uptr row = 0; row < PAGE_BANDS; ++row)
+      want.rows[row] = cells->rows[row] | s_commonCells.rows[row];
+  }
 
-  // Initialize decompression state
-  decompress_state_t *decomp = (decompress_state_t*)Alloc(sizeof(decompress_state_t));
-  InitDecompression(&f, decomp);
+  // If another page is streaming, finish it first
+  if ((s_streamer.page >= 0) && (s_streamer.page != p))
+    PumpPageStream(&s_streamer, PAGE_BANDS, true);
 
-  do {
-    curHeight >>= 1;
-    LOG_INFO(FMT.s("Fragmenting down to ").i(curHeight).STR);
-    imageData = (u32*)Alloc(2048*4*curHeight);
-  } while (!imageData);
+  // Stream page, if it hasn't been prefetched
+  if ((s_texPage[s_frontTexture^1] != p) && (s_streamer.page < 0))
+    StartPageStream(&s_streamer, p, &want);
 
-  ASSERT(curHeight > 0);
+  PumpPageStream(&s_streamer, PAGE_BANDS, true);
 
-  u32 curY = 0;
-  while (curY < 2048) {
-    for (uptr i = 0; i < 2048*curHeight; ++i)
-      imageData[i] = WritePixel(decomp);
+  // Page is in the back texture, swap it to the front
+  ASSERT(s_texPage[s_frontTexture^1] == p);
+  s_frontTexture ^= 1;
 
-//    f.f->read(&f, imageData, 2048*4*curHeight);
-#ifndef APPLE_RENDER
-    GLF(TexSubImage2D(gl::TEXTURE_2D, 0, 0, curY, 2048, curHeight,
-                      gl::BGRA, gl::UNSIGNED_BYTE, imageData));
+  // Upload cells a prefetch didn't
+  RequirePageCells(s_frontTexture, &want);
 #else
-    AppleLoadTexturePart(imageData, 0, curY, 2048, curY + curHeight);
+  (void)cells;
+  StartPageStream(&s_streamer, p, &S_AllPageCells);
+  PumpPageStream(&s_streamer, PAGE_BANDS, true);
 #endif
-    curY += curHeight;
-  }
+}
+
+// Create OpenGL window
+void CreateWindow(canvas_t *out, const char *title) {
+  // Apple usees its own window implementation, so all CreateWindow has to do is
+  // initialize the renderer.
+#ifndef APPLE_RENDER
+  if (!CreateOpenGLCanvas(out, title, GAME_WIDTH, GAME_HEIGHT))
+    LOG_ERROR("Cannot create OpenGL canvas!");
+
+  s_gl = &out->c.gl.f;
+
+  if (!InitProgram())
+    LOG_ERROR("Cannot create shader program!");
+
+  InitBuffers();
+  InitTextures();
+
+  GLF(UseProgram(s_program));
+#else   //ifndef APPLE_RENDER
+  (void)out; (void)title;
+#endif  //ifdef APPLE_RENDER
+
+  // No page is currently active
+  s_curPage = -1;
+  InitPageStreamer(&s_streamer);
 
-  Free(imageData);
-  CloseFile(&f);
+#ifndef APPLE_RENDER
+  // Enable alpha blending
+//  GLF(Enable(gl::BLEND));
+//  GLF(BlendFunc(gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA));
+
+  // Enable depth test
+  GLF(Enable(gl::DEPTH_TEST));
+  GLF(DepthFunc(gl::LESS));
+  GLF(DepthRange(0.f, 1.f));
+
+  // Enable scissor test
+  GLF(Enable(gl::SCISSOR_TEST));
+
+  // Everything's set up, hand the context to the render thread
+  InitRenderer(&s_renderer, out);
+#endif  //ifndef APPLE_RENDER
+
+  // Set default clear color
+  SetClearColor(0.f, 0.f, 0.f);
 }
 
-#endif //COMPRESS_TEXTURES
+// Close OpenGL window, freeing any OpenGL resources along the way
+void CloseWindow(canvas_t *c) {
+  // Apple uses its own window implementation, so all CloseWindow has to do is
+  // shut down the renderer.
+#ifndef APPLE_RENDER
+  FreeRenderer(&s_renderer);
+#endif
+
+  FreePageStreamer(&s_streamer);
+
+#ifndef APPLE_RENDER
+  GLF(DeleteTextures(2, s_textures));
+  GLF(BindBuffer(gl::ELEMENT_ARRAY_BUFFER, 0));
+  GLF(BindBuffer(gl::ARRAY_BUFFER, 0));
+  GLF(BindVertexArray(0));
+  GLF(DeleteBuffers(2, s_buf));
+  GLF(DeleteVertexArrays(1, &s_vao));
+  GLF(DeleteProgram(s_program));
+
+  CloseCanvas(c);
+#else   //ifndef APPLE_RENDER
+  (void)c;
+#endif  //ifdef APPLE_RENDER
+}
 
 // Draw image
 void DrawImage(vec4 pos, vec4 scale, image_id_t img) {
@@ -589,15 +1290,18 @@ void DrawImage(vec4 pos, vec4 scale, image_id_t img) {
 
   // Setup vertices
 #ifndef APPLE_RENDER
-  ASSERT(s_vertCount+4 <= VBO_VERTS);
+  render_frame_t *f = CurFrame();
+  ASSERT(f->vertCount+4 <= FRAME_VERTS);
+
+  RequireQuadCells(S_Images+img, 1);
 
-  OrphanVertBuf();
-  s_vertBuf[s_vertCount].pos = pos+S_Images[img].v[0].pos*scale;
-  s_vertBuf[s_vertCount+1].pos = pos+S_Images[img].v[1].pos*scale;
-  s_vertBuf[s_vertCount+2].pos = pos+S_Images[img].v[2].pos*scale;
-  s_vertBuf[s_vertCount+3].pos = pos+S_Images[img].v[3].pos*scale;
+  vertex_t *v = f->verts+f->vertCount;
+  v[0].pos = pos+S_Images[img].v[0].pos*scale;
+  v[1].pos = pos+S_Images[img].v[1].pos*scale;
+  v[2].pos = pos+S_Images[img].v[2].pos*scale;
+  v[3].pos = pos+S_Images[img].v[3].pos*scale;
 
-  s_vertCount += 4;
+  f->vertCount += 4;
 #else
   rquad_t quad;
 
@@ -613,21 +1317,56 @@ void DrawQuads(const rquad_t *quads, uptr quadCount) {
   ASSERT(quadCount > 0);
 
 #ifndef APPLE_RENDER
-  ASSERT(s_vertCount+quadCount*4 <= VBO_VERTS);
+  render_frame_t *f = CurFrame();
+  ASSERT(f->vertCount+quadCount*4 <= FRAME_VERTS);
 
-  OrphanVertBuf();
-  memcpy(s_vertBuf+s_vertCount, quads, sizeof(rquad_t)*quadCount);
+  RequireQuadCells(quads, quadCount);
 
-  s_vertCount += quadCount*4;
+  memcpy(f->verts+f->vertCount, quads, sizeof(rquad_t)*quadCount);
+  f->vertCount += quadCount*4;
 #else
   AppleDrawQuads(quads, quadCount);
 #endif
 }
 
+// Draw quad once per instance, offset by (x[i], y[i])
+void DrawQuadInstances(const rquad_t *quad, const f32 *x, const f32 *y, uptr count) {
+  ASSERT(count > 0);
+
+#ifndef APPLE_RENDER
+  render_frame_t *f = CurFrame();
+
+  // Drop instances that don't fit in this frame
+  const uptr room = (FRAME_VERTS-f->vertCount)>>2;
+  if (count > room) count = room;
+
+  // Every instance covers the same cells
+  RequireQuadCells(quad, 1);
+
+  ExpandQuadInstances(f->verts+f->vertCount, quad, x, y, count);
+  f->vertCount += count*4;
+#else
+  rquad_t quads[64];
+
+  while (count) {
+    const uptr batch = (count < 64) ? count : 64;
+
+    ExpandQuadInstances(quads->v, quad, x, y, batch);
+    AppleDrawQuads(quads, batch);
+
+    x += batch;
+    y += batch;
+    count -= batch;
+  }
+#endif
+}
+
 // Set renderer clear color
 void SetClearColor(f32 r, f32 g, f32 b) {
 #ifndef APPLE_RENDER
-  GLF(ClearColor(r, g, b, 1.f));
+  s_clearColor[0] = r;
+  s_clearColor[1] = g;
+  s_clearColor[2] = b;
 #else
   AppleSetClearColor(r, g, b);
 #endif
@@ -635,20 +1374,39 @@ void SetClearColor(f32 r, f32 g, f32 b) {
 
 // Render game state
 void RenderGame() {
-#ifndef APPLE_RENDER
-  GLF(Clear(gl::COLOR_BUFFER_BIT|gl::DEPTH_BUFFER_BIT));
+  // Upload prefetched page bands
+  PumpPageStream(&s_streamer, PAGE_BANDS_PER_FRAME, false);
 
-  // Unmap buffer
-  if (s_vertBuf) {
-    GLF(UnmapBuffer(gl::ARRAY_BUFFER));
-    s_vertBuf = NULL;
+#ifndef APPLE_RENDER
+  renderer_t *r = &s_renderer;
+  render_frame_t *f = CurFrame();
+
+  f->clearColor[0] = s_clearColor[0];
+  f->clearColor[1] = s_clearColor[1];
+  f->clearColor[2] = s_clearColor[2];
+  f->texture = s_frontTexture;
+
+  if (r->threaded) {
+    // Hand the frame to the render thread, then wait until
+    // it's done with the other one
+    r->cur ^= 1;
+    SignalSema(&r->submit);
+    WaitSema(&r->free);
+
+    // The frame before this one is done
+    ReleasePageBands(&s_streamer);
+    MarkSubmittedCells();
+  } else {
+    SubmitFrame(f);
+    RenderCanvas(r->canvas);
+
+    MarkSubmittedCells();
+    ReleasePageBands(&s_streamer);
   }
 
-  // Render verts
-  if (s_vertCount) {
-    GLF(DrawElements(gl::TRIANGLES, (s_vertCount>>2)*6, gl::UNSIGNED_SHORT, NULL));
-    s_vertCount = 0;
-  }
+  f = CurFrame();
+  f->vertCount = 0;
+  f->uploadCount = 0;
 #else
   // On apple, the game is rendered by RenderView in plat/apple_view.mm
 #endif
@@ -47,8 +47,25 @@ void CreateWindow(canvas_t *out, const char *title);
 // Destroy window
 void CloseWindow(canvas_t *c);
 
+// Set of 128x128 page cells, one bit per cell
+struct page_cells_t {
+  u16 rows[16];
+};
+
+// Add cells covered by quads' texture coordinates to cells
+void MarkPageCells(page_cells_t *cells, const rquad_t *quads, uptr quadCount);
+
 // Set image page
-void SetPage(page_t p);
+// Only cells, and the cells of images drawn in every room, are
+// uploaded up front, other cells are uploaded the first time
+// they're drawn. If cells is NULL, the whole page is uploaded
+// Blocks until the page is uploaded, unless it's been prefetched
+void SetPage(page_t p, const page_cells_t *cells = NULL);
+
+// Hint that page p will be set soon, so it can be decoded
+// in the background
+// NOP if another page is already being prefetched
+void PrefetchPage(page_t p);
 
 // Draw image at position, with scale
 //
@@ -60,6 +77,10 @@ void DrawImage(vec4 pos, vec4 scale, image_id_t img);
 // Draw quads to screen
 void DrawQuads(const rquad_t *quads, uptr quadCount);
 
+// Draw quad count times, offset by each (x[i], y[i])
+// A frame holds 128k quads, instances that don't fit are dropped
+void DrawQuadInstances(const rquad_t *quad, const f32 *x, const f32 *y, uptr count);
+
 // Set renderer clear color
 void SetClearColor(f32 r, f32 g, f32 b);
 
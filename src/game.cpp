@@ -42,6 +42,9 @@
 #include "audio.h"
 #include "log.h"
 #include "str.h"
+#include "particle.h"
+#include "room.h"
+#include "asset.h"
 #include "loveylib/file.h"
 
 #include <cstring>
@@ -77,11 +80,11 @@ static constexpr const bfast DEBUG_KEYS = false;
 static constexpr const bfast DEBUG_KEYS = true;
 #endif
 
-static const char * const INITIAL_ROOM = "data/room/intro0.rm";
-static const char * const EDITOR_LEVEL = "data/room/13.rm";
+static constexpr const asset_id_t INITIAL_ROOM = ASSET_INTRO0_ROOM;
+static constexpr const asset_id_t EDITOR_LEVEL = ASSET_13_ROOM;
 static const char * const EDITOR_DESTINATION = "data/room/.rm";
 static constexpr const bfast OPEN_EDITOR_LEVEL = true;
-static const char * const EDITOR_BGM = "data/bgm/world1.wav";
+static constexpr const asset_id_t EDITOR_BGM = ASSET_WORLD1_BGM;
 static constexpr const u8 EDITOR_PAGE = 0;
 static const tile_t S_TileCode[ETILE_COUNT] = {
   TILE_NONE,
@@ -311,8 +314,12 @@ static bfast TileMaskCol(const ivec4 bbox, i32 x, i32 y, tile_mask_t m) {
   return false;
 }
 
+// Tile collision queries this frame, for telemetry
+static u32 s_collisionQueries;
+
 // Check for collision with tile type in tile map
-static tile_t *TileCol(ivec4 inBbox, tile_map_t map, tile_id_t id, tile_bit_t bit = 0xffff) {
+static const tile_t *TileCol(ivec4 inBbox, const tile_map_t map, tile_id_t id, tile_bit_t bit = 0xffff) {
+  ++s_collisionQueries;
   id <<= TILE_IDSHIFT;
 
   ivec4 bbox = inBbox;
@@ -337,7 +344,7 @@ static tile_t *TileCol(ivec4 inBbox, tile_map_t map, tile_id_t id, tile_bit_t bi
   // Top to bottom
   for (uptr y = bbox.v[1]; y <= (uptr)bbox.v[3]; ++y) {
     for (uptr x = bbox.v[0]; x <= (uptr)bbox.v[2]; ++x) {
-      tile_t &t = map[y*TILE_MAP_WIDTH + x];
+      const tile_t &t = map[y*TILE_MAP_WIDTH + x];
       if ((t&bit) &&
           ((t&TILE_IDMASK) == id) &&
           TileMaskCol(inBbox, x, y, (t&TILE_MASKMASK)>>TILE_MASKSHIFT))
@@ -370,8 +377,35 @@ static const entity_init_func_t S_EntityInit[ENT_COUNT] = {
   InitIdleKid, InitThunder, InitDragonPart,
 };
 
+// Initialize particle pool, all slabs are free
+static void InitParticlePool(particle_pool_t *p) {
+  for (uptr i = 0; i < PARTICLE_SLAB_COUNT-1; ++i)
+    p->slabs[i].nextFree = p->slabs+i+1;
+  p->slabs[PARTICLE_SLAB_COUNT-1].nextFree = NULL;
+
+  p->firstFree = p->slabs;
+}
+
+// Take slab from particle pool
+// Returns NULL if every slab is in use
+static void *AllocParticleSlab(particle_pool_t *p) {
+  particle_slab_t *ret = p->firstFree;
+  if (ret) p->firstFree = ret->nextFree;
+
+  return ret;
+}
+
+// Give slab back to particle pool
+static void FreeParticleSlab(particle_pool_t *p, void *slab) {
+  particle_slab_t *s = (particle_slab_t*)slab;
+  ASSERT((s >= p->slabs) && (s < p->slabs+PARTICLE_SLAB_COUNT));
+
+  s->nextFree = p->firstFree;
+  p->firstFree = s;
+}
+
 // Add entity to list, and initialize entity
-static entity_t *AddEntity(entity_init_t *initData) {
+static entity_t *AddEntity(const entity_init_t *initData) {
   // Allocate entity in buffer
   entity_t *e = GetBufferItem(g_state->entityBuf);
   if (!e) LOG_ERROR("Entity buffer is full!");
@@ -575,7 +609,7 @@ static void InitDragonDefeat(entity_t *me, entity_init_t *i) {
   StopSound(SND_MIKOO);
 }
 
-static void LoadRoom(const char *roomName);
+static void LoadRoom(asset_id_t room);
 static void UpdateDragonDefeat(entity_t *me, const input_t*) {
   dragon_defeat_t *d = (dragon_defeat_t*)me;
   vec4 offset = ZeroVec4();
@@ -608,7 +642,7 @@ static void UpdateDragonDefeat(entity_t *me, const input_t*) {
 
   if (d->timer == DRAGONDEFEAT_SPEAKTIMER) PlaySound(SND_MIKOODEFEATED);
   else if (d->timer == DRAGONDEFEAT_ROOMTIMER) {
-    LoadRoom("data/room/clear.rm");
+    LoadRoom(ASSET_CLEAR_ROOM);
     g_state->resetTick = true;
   } else if (d->timer >= DRAGONDEFEAT_BGTIMER) {
     SetClearColor(d->curBgR += DRAGONDEFEAT_CHANGEBGR,
@@ -747,7 +781,7 @@ static void InitIntro(entity_t *me, entity_init_t *data) {
   (void)data;
 
   // Get intro image from room name
-  image_id_t img = IMG_INTRO0 + g_state->roomName[sizeof("data/room/intro")-1]-'0';
+  image_id_t img = IMG_INTRO0 + GetAssetName(g_state->roomId)[sizeof("data/room/intro")-1]-'0';
   ASSERT((img >= IMG_INTRO0) && (img <= IMG_INTRO5));
 
   me->b.pos = VEC4(0.f, 608.f-32.f, 0.f, 0.f);
@@ -763,20 +797,10 @@ static constexpr const ufast EMITTER_PARTICLEFREQ = 40;
 static constexpr const f32 EMITTER_BLOODGRAVITYBASE = -0.2f/GAME_HEIGHT;
 static constexpr const f32 EMITTER_BLOODGRAVITYADD = -0.4f/GAME_HEIGHT;
 
-struct blood_particle_info_t {
-  vec4 speed; // = <hspeed vspeed gravity 0>
-};
-
-struct blood_particles_t {
-  rquad_t quads[EMITTER_LIFETIME*EMITTER_PARTICLEFREQ];
-  blood_particle_info_t info[EMITTER_LIFETIME*EMITTER_PARTICLEFREQ];
-};
-
 struct blood_emitter_t {
   entity_base_t b;
 
-  blood_particles_t *particles;
-  uptr particleCount;
+  particle_system_t *particles; // Lives in a particle slab
 };
 
 static void UpdateBloodEmitter(entity_t *me, const input_t *i);
@@ -792,58 +816,57 @@ static void InitBloodEmitter(entity_t *me, entity_init_t *i) {
 
   b->b.pos = i->v4[0]*VEC4(2.f/GAME_WIDTH, 2.f/GAME_HEIGHT, 1.f, 0.f)-VEC4(1.f, 1.f, 0.f, 0.f);
   b->b.info = &S_BloodEmitterInfo;
-  b->particles = (blood_particles_t*)Alloc(sizeof(blood_particles_t));
-  b->particleCount = 0;
+  b->particles = NULL;
 
   SetNullSprite(&b->b.spr);
+
+  // Don't bother with blood if every slab is taken
+  void *slab = AllocParticleSlab(&g_state->particlePool);
+  if (!slab) {
+    RemoveEntity(me);
+    return;
+  }
+
+  b->particles = CreateParticleSystem(slab, PARTICLE_SLAB_SIZE);
+  ASSERT(b->particles->capacity >= EMITTER_LIFETIME*EMITTER_PARTICLEFREQ);
 }
 
 static void UpdateBloodEmitter(entity_t *me, const input_t *input) {
   (void)input;
 
   blood_emitter_t *b = (blood_emitter_t*)me;
+  particle_system_t *ps = b->particles;
 
-  uptr i;
-  if (b->particleCount < EMITTER_LIFETIME*EMITTER_PARTICLEFREQ) {
+  if (ps->count < EMITTER_LIFETIME*EMITTER_PARTICLEFREQ) {
     for (uptr j = 0; j < EMITTER_PARTICLEFREQ; ++j) {
-      i = b->particleCount++;
-
-      b->particles->info[i].speed = ZeroVec4();
       const f32 dir = M_PI * (f32)(Random(&g_state->seed)&65535)*(2.f/65536.f);
       const f32 spd = 6.f * (f32)(Random(&g_state->seed)&65535)*(2.f/65536.f);
-      b->particles->info[i].speed.v[2] =
+      const f32 gravity =
         EMITTER_BLOODGRAVITYADD*(f32)(Random(&g_state->seed)&65535)*(1.f/65536.f) +
-        EMITTER_BLOODGRAVITYBASE;;
+        EMITTER_BLOODGRAVITYBASE;
 
-      b->particles->info[i].speed.v[0] = cosf(dir)*spd/GAME_WIDTH;
-      b->particles->info[i].speed.v[1] = sinf(dir)*spd/GAME_HEIGHT;
-
-      b->particles->quads[i] = S_BloodQuad;
-      b->particles->quads[i].v[0].pos += b->b.pos;
-      b->particles->quads[i].v[1].pos += b->b.pos;
-      b->particles->quads[i].v[2].pos += b->b.pos;
-      b->particles->quads[i].v[3].pos += b->b.pos;
+      AddParticle(ps, b->b.pos.v[0], b->b.pos.v[1],
+                  cosf(dir)*spd/GAME_WIDTH, sinf(dir)*spd/GAME_HEIGHT, gravity);
     }
   }
 
-  // Update all quads
-  for (i = 0; i < b->particleCount; ++i) {
-    vec4 spd = b->particles->info[i].speed&VEC4_I(-1, -1, 0, 0);
-    b->particles->quads[i].v[0].pos += spd;
-    b->particles->quads[i].v[1].pos += spd;
-    b->particles->quads[i].v[2].pos += spd;
-    b->particles->quads[i].v[3].pos += spd;
+  // Update all particles
+  UpdateParticles(ps);
 
-    b->particles->info[i].speed.v[1] += b->particles->info[i].speed.v[2];
-  }
+  // Draw all particles, at the emitter's depth
+  rquad_t quad = S_BloodQuad;
+  const vec4 depth = b->b.pos&VEC4_I(0, 0, -1, 0);
+  quad.v[0].pos += depth;
+  quad.v[1].pos += depth;
+  quad.v[2].pos += depth;
+  quad.v[3].pos += depth;
 
-  // Draw all quads
-  DrawQuads(b->particles->quads, b->particleCount);
+  DrawParticles(ps, &quad);
 }
 
 static void DestroyBloodEmitter(entity_t *me) {
   blood_emitter_t *b = (blood_emitter_t*)me;
-  Free(b->particles);
+  if (b->particles) FreeParticleSlab(&g_state->particlePool, b->particles);
 }
 
 // Gameover entity
@@ -890,7 +913,7 @@ struct warp_t {
   entity_base_t b;
 
   // Warp destination
-  char destination[32];
+  asset_id_t destination;
 };
 static_assert(sizeof(warp_t) <= sizeof(entity_t), "");
 
@@ -905,7 +928,7 @@ static void InitWarp(entity_t *me, entity_init_t *i) {
 
   w->b.pos = i->v4[0];
   w->b.scale = VEC4(1, 1, 1, 1);
-  strcpy(w->destination, i->str);
+  w->destination = InternAsset(i->str);
   w->b.info = &S_WarpInfo;
 
 //  SetImageSprite(&w->b.spr, IMG_WARP);
@@ -1108,7 +1131,7 @@ static void MoveKid(kid_t *me, vec4 offset) {
     vec4 frac = me->b.pos-ToVec4(ToIvec4(me->b.pos));
 
     ivec4 bbox = GetKidBbox(newPos);
-    tile_t *t;
+    const tile_t *t;
     if ((t = TileCol(bbox, g_state->room->map, TILE_BLOCK))) {
       if (offset.v[0] > 0)
         newPos.v[0] = AlignUpMask((i32)newPos.v[0]-KID_BBOX.v[2], TILE_SIZE-1)-KID_BBOX.v[2];
@@ -1152,7 +1175,7 @@ static void MoveKid(kid_t *me, vec4 offset) {
   me->b.pos = newPos;
 }
 
-static void LoadRoom(const char *roomName);
+static void LoadRoom(asset_id_t room);
 static void UpdateKid(entity_t *me, const input_t *i) {
   kid_t *k = (kid_t*)me;
   sprite_id_t destSpr = SPR_PSTAND;
@@ -1230,7 +1253,7 @@ static void UpdateKid(entity_t *me, const input_t *i) {
         PlaySound(SND_SPEEDSPELL);
         break;
       case SPELL_FINAL:
-        LoadRoom("data/room/ending.rm");
+        LoadRoom(ASSET_ENDING_ROOM);
         g_state->resetTick = true;
         g_state->curSpell = SPELL_NONE;
         PlaySound(SND_THUNDER);
@@ -1301,7 +1324,7 @@ static void UpdateKid(entity_t *me, const input_t *i) {
 
   // Platform collision
   bbox = GetKidBbox(me->b.pos);
-  tile_t *t;
+  const tile_t *t;
   if ((t = TileCol(bbox, g_state->room->map, TILE_PLATFORM))) {
     f32 py = ((t-g_state->room->map)/TILE_MAP_WIDTH)*32.f+32.f;
     if (k->b.pos.v[1]-k->vspeed*0.5f >= py) {
@@ -1343,55 +1366,88 @@ static void UpdateKid(entity_t *me, const input_t *i) {
   SetSprite(&me->b.spr, destSpr);
 }
 
-// Set room clear color, based on room name
-static void SetRoomClearColor(const char *filename) {
-  if ((strlen(filename) >= 15) && !memcmp("data/room/intro", filename, 15))
-    SetClearColor(0.f, 0.f, 0.f);
-  else if ((strlen(filename) >= 11) && !memcmp("data/room/2", filename, 11))
-    SetClearColor(0.08f/2.f, 0.182f/2.f, 0.2f/2.f);
-  else if ((strlen(filename) >= 11) && !memcmp("data/room/3", filename, 11))
-    SetClearColor(0.2f, 0.037f, 0.f);
-  else if ((strlen(filename) >= 15) && !memcmp("data/room/clear", filename, 15))
-    SetClearColor(0, 1, 1);
-  else
-    SetClearColor(0.996f, 0.561f, 0.231f);
-}
+// Room properties, the first entry whose prefix starts
+// the room's path is used
+static const room_props_t S_RoomProps[] = {
+  {"data/room/intro", {0.f, 0.f, 0.f}, 0},
+  {"data/room/12.rm", {0.996f, 0.561f, 0.231f}, ROOM_TUTORIALBIT},
+  {"data/room/2", {0.08f/2.f, 0.182f/2.f, 0.2f/2.f}, 0},
+  {"data/room/3", {0.2f, 0.037f, 0.f}, 0},
+  {"data/room/clear", {0.f, 1.f, 1.f}, 0},
+  {"", {0.996f, 0.561f, 0.231f}, 0},
+};
 
-// Load room
-static void LoadRoom(const char *filename) {
-  // Load room file
-  if (!g_state->room || USE_EDITOR || strcmp(g_state->roomName, filename)) {
-    SetRoomClearColor(filename);
+// Properties of each room, found the first time they're asked for
+static const room_props_t *s_roomProps[MAX_ASSETS];
 
-    strcpy(g_state->roomName, filename);
+// Get room properties
+static const room_props_t *GetRoomProps(asset_id_t room) {
+  if (s_roomProps[room]) return s_roomProps[room];
 
-    // Free room, if it exists
-    if (g_state->room) Free(g_state->room);
+  const char * const name = GetAssetName(room);
+  const room_props_t *p = S_RoomProps;
+  while (strncmp(name, p->prefix, strlen(p->prefix))) ++p;
 
-    stream_t f = {};
-    if (!OpenFile(&f, filename, FILE_READ_ONLY))
-      LOG_ERROR(FMT.s("Cannot open room ").s(filename).STR);
+  s_roomProps[room] = p;
+  return p;
+}
 
-    // Get file size
-    f.f->seek(&f, 0, ORIGIN_END);
-    const iptr fileSize = f.f->tell(&f);
-    f.f->seek(&f, 0, ORIGIN_SET);
+// Set room clear color
+static void SetRoomClearColor(asset_id_t room) {
+  const room_props_t *p = GetRoomProps(room);
+  SetClearColor(p->clear[0], p->clear[1], p->clear[2]);
+}
 
-    // Make sure file size is valid
-    if (fileSize <= (iptr)sizeof(room_t))
-      LOG_ERROR(FMT.s(filename).s(" isn't a room!").STR);
+// Prefetch image pages of the rooms the current room's
+// warps lead to, once they've been read
+static void PrefetchWarpPages() {
+  if (g_state->warpPagesPrefetched) return;
 
-    // Allocate room
-    g_state->room = (room_t*)Alloc(fileSize);
+  bfast done = true;
+  for (uptr i = 0; i < g_state->warpRoomCount; ++i) {
+    const room_t *room;
+    if (!PollRoom(g_state->warpRooms[i], &room)) done = false;
+    else if (room && (room->page < NUM_PAGES)) PrefetchPage(room->page);
+  }
 
-    // Read & swap room
-    f.f->read(&f, g_state->room, fileSize);
-    CloseFile(&f);
+  g_state->warpPagesPrefetched = done;
+}
 
-    g_state->room->swap();
+// Load room
+static void LoadRoom(asset_id_t room) {
+  // Load room file
+  if (!g_state->room || USE_EDITOR || (g_state->roomId != room)) {
+    SetRoomClearColor(room);
+
+    g_state->roomId = room;
+
+    // The editor rewrites it's room, so always read it again,
+    // other rooms, like prefetched warp rooms, stay cached
+    if (USE_EDITOR && (room == EDITOR_LEVEL)) DropRoom(room);
+    g_state->room = GetRoom(room);
+    g_state->roomBgm = InternAsset(g_state->room->bgm);
+
+    // Set image page, only uploading the cells the room's
+    // quads draw up front
+    page_cells_t cells = {};
+    MarkPageCells(&cells, g_state->room->quads(), g_state->room->quadCount);
+    SetPage(g_state->room->page, &cells);
+
+    // Read the rooms warps lead to in the background, and
+    // start decoding their pages once they're read, so
+    // warping doesn't touch the disk
+    g_state->warpRoomCount = 0;
+    for (uptr i = 0; i < g_state->room->entityCount; ++i) {
+      const entity_init_t *e = &g_state->room->entities()[i];
+      if ((e->ent != ENT_WARP) || (g_state->warpRoomCount == MAX_WARP_ROOMS)) continue;
+
+      const asset_id_t dest = InternAsset(e->str);
+      g_state->warpRooms[g_state->warpRoomCount++] = dest;
+      PrefetchRoom(dest);
+    }
 
-    // Set image page
-    SetPage(g_state->room->page);
+    g_state->warpPagesPrefetched = false;
+    PrefetchWarpPages();
   }
 
   if (g_state->state == GAME_PLAY) {
@@ -1404,7 +1460,7 @@ static void LoadRoom(const char *filename) {
   }
 
   // Play BGM
-  PlayBGM(g_state->room->bgm);
+  PlayBGM(g_state->roomBgm);
 
   // Get rid of current spell
   g_state->curSpell = SPELL_NONE;
@@ -1431,7 +1487,7 @@ static void WriteSave() {
   g_state->save.kidInit.ent = ENT_KID;
 
   // Save room name
-  strcpy(g_state->save.roomName, g_state->roomName);
+  strcpy(g_state->save.roomName, GetAssetName(g_state->roomId));
 }
 
 // Load saved game
@@ -1460,7 +1516,7 @@ static void LoadSave() {
   }
 
   // Load room
-  LoadRoom(g_state->save.roomName);
+  LoadRoom(InternAsset(g_state->save.roomName));
 
   // Add saved kid entity
   AddEntity(&g_state->save.kidInit);
@@ -1470,12 +1526,19 @@ game_state_t *g_state;
 
 void InitGame() {
   // Allocate g_state
-  g_state = (game_state_t*)Alloc(sizeof(game_state_t));
+  g_state = (game_state_t*)Alloc(sizeof(game_state_t), "Game state");
   memset(g_state, 0, sizeof(game_state_t));
 
   // Initialize entity buffer
   InitBuffer(g_state->entityBuf);
 
+  // Initialize particle pool
+  InitParticlePool(&g_state->particlePool);
+
+  // Intern known assets, and initialize room cache
+  InitAssets();
+  InitRooms();
+
   // Randomize RNG seed
   g_state->seed = RandomSeed();
 
@@ -1487,6 +1550,7 @@ void InitGame() {
 }
 
 void FreeGame() {
+  FreeRooms();
   Free(g_state);
 }
 
@@ -1517,11 +1581,11 @@ static void TickGame(input_t *input) {
 }
 
 // Find quad for tile
-static rquad_t *GetTileQuad(rquad_t *quads, uptr quadCount, uptr tilePos) {
+static const rquad_t *GetTileQuad(const rquad_t *quads, uptr quadCount, uptr tilePos) {
   f32 quadX = (f32)(tilePos%TILE_MAP_WIDTH)*2.f/TILE_MAP_WIDTH-1.f;
   f32 quadY = 2.f/TILE_MAP_HEIGHT + (f32)(tilePos/TILE_MAP_WIDTH)*2.f/TILE_MAP_HEIGHT-1.f;
 
-  for (rquad_t *q = quads+quadCount; q-- != quads;)
+  for (const rquad_t *q = quads+quadCount; q-- != quads;)
     if ((q->v[0].pos.v[0] == quadX) &&
         (q->v[0].pos.v[1] == quadY))
       return q;
@@ -1531,7 +1595,7 @@ static rquad_t *GetTileQuad(rquad_t *quads, uptr quadCount, uptr tilePos) {
 }
 
 // Get editor tile from tile and it's quad
-static editor_tile_t EditorTileFromTileQuad(rquad_t *q, tile_t t) {
+static editor_tile_t EditorTileFromTileQuad(const rquad_t *q, tile_t t) {
   switch (t) {
   case (TILE_MASK_FULL<<TILE_MASKSHIFT)|(TILE_BLOCK<<TILE_IDSHIFT):
     switch (q->v[0].coord.x|(q->v[0].coord.y<<16)) {
@@ -1590,7 +1654,7 @@ static void TickTitle(input_t *input) {
     }};
   DrawQuads(&titleQuad, 1);
 
-  PlayBGM("data/bgm/title.wav");
+  PlayBGM(ASSET_TITLE_BGM);
 
   if (input->pressed&INPUT_JUMPBIT) {
     if (!USE_EDITOR) {
@@ -1720,11 +1784,14 @@ static void TickEditor(input_t *input) {
       for (uptr i = 0; i < g_state->entCount; ++i)
         if (IsStaticEntity(&g_state->ents[i])) ++tileCnt;
       
-      room_t *out = (room_t*)Alloc(ROOM_SIZE(g_state->entCount, tileCnt));
+      // Freed at the end of the frame
+      const uptr size = ROOM_SIZE(g_state->entCount, tileCnt);
+      room_hdr_t *hdr = (room_hdr_t*)ScratchAlloc(sizeof(room_hdr_t)+size, "Room");
+      room_t *out = (room_t*)(hdr+1);
       out->entityCount = g_state->entCount;
       out->quadCount = tileCnt;
       out->page = EDITOR_PAGE;
-      strcpy(out->bgm, EDITOR_BGM);
+      strcpy(out->bgm, GetAssetName(EDITOR_BGM));
 
       memcpy(out->entities(), g_state->ents, sizeof(entity_init_t)*g_state->entCount);
 
@@ -1765,15 +1832,26 @@ static void TickEditor(input_t *input) {
         }
       }
 
+      // The cached room may be mapped from the file, which can't
+      // be truncated under it, LoadRoom reads it again
+      DropRoom(EDITOR_LEVEL);
+      if (g_state->roomId == EDITOR_LEVEL) g_state->room = NULL;
+
       stream_t f = {};
-      if (OpenFile(&f, EDITOR_LEVEL, FILE_WRITE_ONLY)) {
+      if (OpenFile(&f, GetAssetName(EDITOR_LEVEL), FILE_WRITE_ONLY)) {
         out->swap();
-        f.f->write(&f, out, ROOM_SIZE(g_state->entCount, tileCnt));
+
+        memset(hdr, 0, sizeof(room_hdr_t));
+        hdr->magic = ROOM_MAGIC;
+        hdr->version = ROOM_VERSION;
+        hdr->size = size;
+        hdr->checksum = RoomChecksum((const u8*)out, size);
+        hdr->swap();
+
+        f.f->write(&f, hdr, sizeof(room_hdr_t)+size);
         CloseFile(&f);
         LOG_STATUS("Level written");
       } else LOG_STATUS("!! Unable to save level! !!");
-
-      Free(out);
     }
 
     // Start gameplay
@@ -1893,13 +1971,17 @@ static const rquad_t S_SpellTutQuad = {{
   }};
 
 void UpdateGame(input_t *input) {
+  u32 entities = 0;
+
+  if (g_state->room) PrefetchWarpPages();
+
   switch (g_state->state) {
   case GAME_PLAY:
     // Quick reset to 1-1
     if ((input->down&(INPUT_UPBIT|INPUT_DOWNBIT|INPUT_NEWGAMEBIT)) ==
         (INPUT_UPBIT|INPUT_DOWNBIT|INPUT_NEWGAMEBIT))
     {
-      LoadRoom("data/room/11.rm");
+      LoadRoom(ASSET_11_ROOM);
       input->pressed &= ~INPUT_NEWGAMEBIT;
     }
 
@@ -1907,6 +1989,7 @@ void UpdateGame(input_t *input) {
 
     // Draw all entities in list
     for (entity_t *e = g_state->firstEntity; e; e = e->b.next) {
+      ++entities;
       if (e->b.spr.img == IMG_NONE) continue;
 
       const vec4 pos = e->b.pos*VEC4(2.f/GAME_WIDTH, 2.f/GAME_HEIGHT, 1.f, 0)-VEC4(1, 1, 0, 0);
@@ -1921,7 +2004,7 @@ void UpdateGame(input_t *input) {
       DrawQuads(&S_SpellQuad[g_state->curSpell-1], 1);
 
       // If we're on level 2, show spell tutorial text
-      if (!strcmp(g_state->roomName, "data/room/12.rm"))
+      if (GetRoomProps(g_state->roomId)->flags&ROOM_TUTORIALBIT)
         DrawQuads(&S_SpellTutQuad, 1);
     }
     break;
@@ -1934,4 +2017,10 @@ void UpdateGame(input_t *input) {
   }
 
   RenderGame();
+
+  LOG_EVENT(TEL_UPDATE, entities, s_collisionQueries, (u32)g_scratchTop);
+  s_collisionQueries = 0;
+
+  // Free this frame's temporary allocations
+  ResetScratch();
 }
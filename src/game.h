@@ -38,6 +38,7 @@
 #include "loveylib/random.h"
 #include "loveylib/endian.h"
 #include "vertex.h"
+#include "asset.h"
 
 static constexpr const u32 GAME_WIDTH = 800;
 static constexpr const u32 GAME_HEIGHT = 608;
@@ -334,7 +335,27 @@ enum editor_tile_e : ufast {
 };
 typedef ufast editor_tile_t;
 
+// Room file header, the room follows it
+static constexpr const u32 ROOM_MAGIC = CLITTLE_ENDIAN32('I' | ('W'<<8) | ('R'<<16) | ('M'<<24));
+static constexpr const u16 ROOM_VERSION = 1;
+
+struct alignas(64) room_hdr_t {
+  u32 magic; // == ROOM_MAGIC
+  u16 version; // == ROOM_VERSION
+  u16 pad;
+  u32 size; // Size of the room after the header
+  u32 checksum; // RoomChecksum of the room
+
+  inline void swap() {
+    version = LittleEndian16(version);
+    size = LittleEndian32(size);
+    checksum = LittleEndian32(checksum);
+  }
+};
+
 // Room, externally loaded
+// Files without a room_hdr_t are older rooms, and are
+// loaded without being checked
 #define ROOM_SIZE(_ent, _quads) (sizeof(room_t)+sizeof(entity_init_t)*(_ent)+sizeof(rquad_t)*(_quads))
 struct alignas(64) room_t {
   // BGM filename
@@ -357,9 +378,11 @@ struct alignas(64) room_t {
 
   // Entity initialization data buffer
   inline entity_init_t *entities() {return (entity_init_t*)(this+1);}
+  inline const entity_init_t *entities() const {return (const entity_init_t*)(this+1);}
 
   // Quad buffer
   inline rquad_t *quads() {return (rquad_t*)(entities()+entityCount);}
+  inline const rquad_t *quads() const {return (const rquad_t*)(entities()+entityCount);}
 
   // Swap endianness
   void swap() {
@@ -384,6 +407,22 @@ struct alignas(64) room_t {
   }
 };
 
+// Room flags
+enum room_flag_e : u8 {
+  ROOM_TUTORIALBIT = 0x01, // Shows the spell tutorial
+};
+typedef u8 room_flags_t;
+
+// Room properties, picked by the room's path
+struct room_props_t {
+  const char *prefix;
+  f32 clear[3]; // Clear color
+  room_flags_t flags;
+};
+
+// Most warp destinations prefetched per room
+static constexpr const uptr MAX_WARP_ROOMS = 7;
+
 // Room container
 template<uptr N, uptr N2>
 struct room_container_t {
@@ -435,6 +474,26 @@ enum spell_e : ufast {
 };
 typedef ufast spell_t;
 
+// Particle slab pool
+// Particle effects take their storage from here instead of
+// the arena, so spawning them doesn't allocate
+static constexpr const uptr PARTICLE_SLAB_SIZE = 64*1024;
+static constexpr const uptr PARTICLE_SLAB_COUNT = 4;
+
+// Slabs are cache line aligned like rquad_t, so anything kept
+// in them, up to a quad, is aligned and no two slabs share a line
+union alignas(64) particle_slab_t {
+  particle_slab_t *nextFree; // Next free slab, while free
+  u8 data[PARTICLE_SLAB_SIZE];
+};
+
+static_assert(alignof(particle_slab_t) >= alignof(rquad_t), "");
+
+struct particle_pool_t {
+  particle_slab_t slabs[PARTICLE_SLAB_COUNT];
+  particle_slab_t *firstFree;
+};
+
 // Global game state
 // Valid while game is active
 static constexpr const uptr MAX_ENTITIES = 256;
@@ -442,12 +501,25 @@ struct game_state_t {
   // Entity buffer
   buffer_container_t<entity_t, MAX_ENTITIES> entityBuf;
 
+  // Particle storage
+  particle_pool_t particlePool;
+
   // First and last entity in linked list
   entity_t *firstEntity, *lastEntity;
 
-  // Current room pointer, with filename
-  char roomName[48];
-  room_t *room;
+  // Current room pointer, with it's ID and BGM
+  // The room is owned by the room cache
+  asset_id_t roomId;
+  asset_id_t roomBgm;
+  const room_t *room;
+
+  // Rooms the current room's warps lead to
+  asset_id_t warpRooms[MAX_WARP_ROOMS];
+  uptr warpRoomCount;
+
+  // Set once the pages of the rooms the current room's
+  // warps lead to are being decoded
+  bfast warpPagesPrefetched;
 
   // RNG seed
   rng_seed_t seed;
@@ -48,7 +48,10 @@ void CloseLogStreams() {
 }
 
 [[noreturn]] void LogErrorExplicit(const char *file, int line, const char *str) {
+  // Make room for the error, messages are dropped if the log is full
+  FlushDefaultLogStreams(g_streams);
   LogInfoExplicit(g_streams, file, line, str);
+  FlushDefaultLogStreams(g_streams);
 
 #ifdef LOVEYLIB_APPLE
   AppleAlert(str);
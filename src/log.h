@@ -33,6 +33,7 @@
 
 #include "loveylib/types.h"
 #include "loveylib/log.h"
+#include "telemetry.h"
 
 extern log_streams_t g_streams;
 
@@ -46,6 +47,9 @@ void CloseLogStreams();
 // LOG_INFO: Log miscellaneous info
 // LOG_STATUS: Log information about status, shown to end user
 // LOG_ERROR: Log fatal error then quit, shown to end user
+// LOG_EVENT: Record binary telemetry event, in release too (see telemetry.h)
+
+#define LOG_EVENT(...) RecordEvent(__VA_ARGS__)
 
 // Don't log info or show filename in release build
 #ifndef NDEBUG
@@ -0,0 +1,146 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/atomic.h:
+ *  Lightweight synchronization primitives
+ *
+ ************************************************************/
+
+#ifndef _LOVEYLIB_ATOMIC_H
+#define _LOVEYLIB_ATOMIC_H
+
+#include "loveylib/types.h"
+#include "loveylib_config.h"
+
+#include <atomic>
+
+#ifdef LOVEYLIB_SSE
+#include <xmmintrin.h>
+#endif
+
+/*
+ * Loads, stores, compare-exchanges and fetch-adds use std::atomic,
+ * with explicit memory orders.
+ *
+ * Light mutexes and events are a single 32-bit word. They spin
+ * for a while when they can't be taken, then park the thread
+ * on the word (a futex on Linux, WaitOnAddress on Win32), so
+ * uncontended locks and signals never make a syscall.
+ *
+ * On other platforms, parked threads yield until they're woken.
+ */
+
+// Times to spin before parking
+static constexpr const ufast LIGHT_SPIN_COUNT = 64;
+
+// Tell the processor we're spinning
+static inline void CpuRelax() {
+#ifdef LOVEYLIB_SSE
+  _mm_pause();
+#endif
+}
+
+// Park calling thread while *addr == expected
+// May return early, callers must check *addr again
+void FutexWait(std::atomic<u32> *addr, u32 expected);
+
+// Wake threads parked on addr, one or all of them
+void FutexWake(std::atomic<u32> *addr, bfast all);
+
+// Light mutex
+// Zero-initialized light mutexes are unlocked
+struct light_mutex_t {
+  // 0 = Unlocked
+  // 1 = Locked
+  // 2 = Locked, threads might be parked on it
+  std::atomic<u32> state;
+};
+
+// Light event
+// Auto-reset, waiting on a set event resets it
+// Zero-initialized light events aren't set
+struct light_event_t {
+  // 0 = Not set
+  // 1 = Set
+  // 2 = Not set, threads might be parked on it
+  std::atomic<u32> state;
+};
+
+// Lock mutex, slow path
+void LockLightMutexContended(light_mutex_t *m);
+
+// Wait on event, slow path
+void WaitLightEventContended(light_event_t *e);
+
+// Initialize unlocked mutex
+static inline void InitLightMutex(light_mutex_t *m) {
+  m->state.store(0, std::memory_order_relaxed);
+}
+
+// Lock mutex, blocks until mutex is available
+static inline void LockLightMutex(light_mutex_t *m) {
+  u32 unlocked = 0;
+  if (!m->state.compare_exchange_strong(unlocked, 1, std::memory_order_acquire,
+                                        std::memory_order_relaxed))
+    LockLightMutexContended(m);
+}
+
+// Lock mutex, unless it's already locked
+// Returns true if mutex was locked
+static inline bfast TryLockLightMutex(light_mutex_t *m) {
+  u32 unlocked = 0;
+  return m->state.compare_exchange_strong(unlocked, 1, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+}
+
+// Unlock mutex locked by the calling thread
+static inline void UnlockLightMutex(light_mutex_t *m) {
+  if (m->state.exchange(0, std::memory_order_release) == 2)
+    FutexWake(&m->state, false);
+}
+
+// Initialize event that isn't set
+static inline void InitLightEvent(light_event_t *e) {
+  e->state.store(0, std::memory_order_relaxed);
+}
+
+// Set event, waking up threads waiting on it
+static inline void SetLightEvent(light_event_t *e) {
+  if (e->state.exchange(1, std::memory_order_release) == 2)
+    FutexWake(&e->state, true);
+}
+
+// Wait until event is set, then reset it
+static inline void WaitLightEvent(light_event_t *e) {
+  u32 set = 1;
+  if (!e->state.compare_exchange_strong(set, 0, std::memory_order_acquire,
+                                        std::memory_order_relaxed))
+    WaitLightEventContended(e);
+}
+
+#endif //_LOVEYLIB_ATOMIC_H
@@ -51,7 +51,7 @@ typedef ufast canvas_api_t;
 union canvas_t;
 
 // Canvas data size
-static constexpr const uptr CANVAS_DATA_SIZE = 528;
+static constexpr const uptr CANVAS_DATA_SIZE = 544;
 
 // Canvas vtable
 
@@ -137,4 +137,11 @@ bfast CreateSoftwareCanvas(canvas_t *out, const char *title, u32 width, u32 heig
 // When created, it will automatically become the active canvas
 bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height);
 
+// Make OpenGL canvas' context current on the calling thread if bind
+// is set, otherwise release it from the calling thread
+// A context can only be current on one thread at a time, so it has
+// to be released before another thread binds it
+// Returns false on failure
+bfast BindOpenGLCanvas(canvas_t *c, bfast bind);
+
 #endif //_LOVEYLIB_CANVAS_H
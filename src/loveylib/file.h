@@ -37,6 +37,8 @@
 #include "loveylib/types.h"
 #include "loveylib/stream.h"
 
+#include <atomic>
+
 // File open modes
 enum file_mode_e : ufast {
   // Open the file as read-only
@@ -61,4 +63,105 @@ bfast OpenFile(stream_t *out, const char *name, file_mode_t mode);
 // Close file stream
 void CloseFile(stream_t *f);
 
+// Read-only view of a whole file
+struct mapped_file_t {
+  const u8 *data;
+  uptr size;
+
+  // Set if data is mapped, if it isn't,
+  // the file was read into a heap
+  bfast mapped;
+};
+
+// Map file into memory, read-only
+// If the file can't be mapped, it's read into memory instead
+// Returns false on error
+bfast MapFile(mapped_file_t *out, const char *name);
+
+// Map file opened with OpenFile, read-only
+// The mapping stays valid after the file is closed
+// Returns false on error
+bfast MapFile(mapped_file_t *out, stream_t *f);
+
+// Unmap file mapped by MapFile
+void UnmapFile(mapped_file_t *file);
+
+// Read from file at offset, without using the stream pointer
+// NOTE: On Win32 the stream pointer is moved past the data read,
+//       streams read from this way shouldn't be read normally
+// Returns bytes read, or -1 on error
+iptr ReadFileAt(stream_t *f, void *out, uptr size, u64 offset);
+
+/*
+ * ASYNCHRONOUS READS
+ *
+ * A read is submitted into a buffer, then polled or waited on
+ * until it's done. Reads are done by io_uring on Linux, and by a
+ * few IO threads on other platforms, or if io_uring can't be set
+ * up. Before InitAsyncIO, or without threads, SubmitRead reads
+ * right away.
+ *
+ * The async_read_t, the buffer and the file must stay valid
+ * until the read is done, and the same async_read_t can be
+ * submitted again after that.
+ */
+
+// Most reads in flight at once
+static constexpr const uptr ASYNC_READ_MAX = 64;
+
+// Asynchronous read
+struct async_read_t {
+  // Set to 1 when the read is done
+  std::atomic<u32> done;
+
+  // Bytes read, or -1 on error, valid when done is set
+  iptr result;
+
+  // Read request
+  stream_t *file;
+  void *out;
+  uptr size;
+  u64 offset;
+
+  // Next read in the IO thread queue
+  async_read_t *next;
+};
+
+// Start asynchronous IO
+// Returns false if reads will be done right away by SubmitRead
+bfast InitAsyncIO();
+
+// Stop asynchronous IO, waits for reads in flight
+void FreeAsyncIO();
+
+// Read size bytes at offset in file into out
+// Returns false if ASYNC_READ_MAX reads are in flight,
+// r isn't submitted then
+bfast SubmitRead(async_read_t *r, stream_t *file, void *out, uptr size, u64 offset);
+
+// Check if read is done
+static inline bfast PollRead(const async_read_t *r) {
+  return r->done.load(std::memory_order_acquire);
+}
+
+// Wait for read to be done
+// Returns bytes read, or -1 on error
+iptr WaitRead(async_read_t *r);
+
+// Platform async IO, used by InitAsyncIO
+// Returns false if the platform has none, IO threads are used then
+bfast InitPlatformAsyncIO();
+
+// Stop platform async IO, every read must be done
+void FreePlatformAsyncIO();
+
+// Submit read to platform async IO
+// CompleteRead is called when it's done
+// Returns false if it couldn't be submitted, CompleteRead
+// isn't called then
+bfast SubmitPlatformRead(async_read_t *r);
+
+// Mark read as done, waking threads waiting on it
+void CompleteRead(async_read_t *r, iptr result);
+
 #endif //_LOVEYLIB_FILE_H
@@ -39,6 +39,19 @@
 // Pointer to the beginning of available heap memory
 typedef void *heap_t;
 
+// Heap creation flags
+enum heap_flags_e : ufast {
+  // Fault in committed memory up front, so the first
+  // access doesn't page fault
+  HEAP_PREFAULT_BIT = 1,
+
+  // Back heap with huge pages where possible, explicit
+  // huge pages are tried first, then transparent ones
+  // Ignored if huge pages aren't available
+  HEAP_HUGE_PAGES_BIT = 2,
+};
+typedef ufast heap_flags_t;
+
 // Get memory page size, must be a power of 2
 uptr GetPageSize();
 
@@ -47,9 +60,34 @@ uptr GetPageSize();
 // a multiple of the page size
 //
 // Returns NULL on failure
-heap_t InitHeap(uptr size);
+heap_t InitHeap(uptr size, heap_flags_t flags = 0);
+
+// Reserve heap address space, with size
+// size will be rounded up to a multiple of the page size
+//
+// None of the heap can be used until it's committed
+// with CommitHeap
+// Reserved heaps only use transparent huge pages
+//
+// Returns NULL on failure
+heap_t ReserveHeap(uptr size, heap_flags_t flags = 0);
+
+// Commit part of a reserved heap, so it can be used
+// offset and size must be multiples of the page size
+// Only HEAP_PREFAULT_BIT is used from flags
+//
+// Returns false on failure
+bfast CommitHeap(heap_t heap, uptr offset, uptr size, heap_flags_t flags = 0);
 
-// Destroy heap
+// Give physical memory of part of a heap back to the OS
+// The memory stays usable, but its contents are undefined
+// offset and size must be multiples of the page size
+void ResetHeap(heap_t heap, uptr offset, uptr size);
+
+// Destroy heap, from either InitHeap or ReserveHeap
 void DestroyHeap(heap_t heap);
 
+// Get number of page faults the process has taken so far
+uptr GetPageFaultCount();
+
 #endif //_LOVEYLIB_HEAP_H
@@ -0,0 +1,107 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/job.h:
+ *  Job system
+ *
+ ************************************************************/
+
+#ifndef _LOVEYLIB_JOB_H
+#define _LOVEYLIB_JOB_H
+
+#include "loveylib/types.h"
+
+#include <atomic>
+
+/*
+ * JOBS
+ *
+ * A job is a function and a pointer passed to it. Jobs are
+ * run by a pool of worker threads, and the thread that called
+ * InitJobs, which is worker 0.
+ *
+ * Each worker has it's own queue of jobs. Jobs run from a
+ * worker are pushed onto it's queue, workers run the newest
+ * job in their queue, and steal the oldest job from other
+ * queues when theirs is empty.
+ *
+ * Jobs run from any other thread are pushed onto a shared
+ * queue instead, which workers check before stealing.
+ *
+ * Every job can have a counter, which is incremented when
+ * the job is run, and decremented once it's done. Waiting
+ * on a counter runs other jobs until it reaches 0, so jobs
+ * can wait on the jobs they depend on.
+ *
+ * If there are no worker threads, jobs are run immediately.
+ */
+
+// Job entry point
+typedef void (*job_func_t)(void */*data*/);
+
+// ParallelFor entry point, handles [begin, end)
+typedef void (*parallel_for_func_t)(void */*data*/, uptr /*begin*/, uptr /*end*/);
+
+// Number of jobs that haven't finished
+struct job_counter_t {
+  std::atomic<uptr> pending;
+};
+
+// Initialize job counter, with no pending jobs
+static inline void InitJobCounter(job_counter_t *counter) {
+  counter->pending.store(0, std::memory_order_relaxed);
+}
+
+// Start job system
+// If workerCount is 0, one worker is started per processor,
+// counting the calling thread
+// Returns false if no worker threads could be started,
+// jobs are run immediately in that case
+bfast InitJobs(uptr workerCount = 0);
+
+// Stop job system
+// Must be called from the thread that called InitJobs,
+// once every job is done
+void FreeJobs();
+
+// Get number of workers, counting the thread that called InitJobs
+uptr GetJobWorkerCount();
+
+// Run job, counter can be NULL
+void RunJob(job_func_t func, void *data, job_counter_t *counter);
+
+// Wait until every job counted by counter is done,
+// running other jobs in the meantime
+void WaitJobs(job_counter_t *counter);
+
+// Call func on [0, count), split into ranges of at most
+// grain elements spread over every worker
+// Returns once func has handled every element
+void ParallelFor(uptr count, uptr grain, parallel_for_func_t func, void *data);
+
+#endif //_LOVEYLIB_JOB_H
@@ -48,7 +48,8 @@ static constexpr const uptr MAX_LOG_STREAMS = 4;
 // (log_streams_t s = {})
 typedef stream_t log_streams_t[MAX_LOG_STREAMS];
 
-// Open default streams
+// Open default streams, and start the log thread
+// that writes messages out
 // (s STILL NEEDS TO BE ZEROED OUT)
 //
 // Returns false if no stream could be opened
@@ -59,13 +60,25 @@ bfast OpenDefaultLogStreams(log_streams_t s);
 // OpenDefaultLogStreams, and nothing else!
 void CloseDefaultLogStreams(log_streams_t s);
 
+// Write out log data held back by default streams,
+// waiting for it to be written
+// NOTE: Same as CloseDefaultLogStreams
+void FlushDefaultLogStreams(log_streams_t s);
+
+// Longest message that's logged whole on any target, longer
+// ones are cut short and end with "..."
+static constexpr const uptr LOG_MESSAGE_MAX = 487;
+
 // Log raw string followed by newline to
 // streams in s
 // If a stream in s isn't opened, it will be ignored
+// Never waits on the streams if there's a log thread, messages
+// are dropped if the log thread falls too far behind
 void LogString(log_streams_t s, const char *str);
 
 // LogString but with (optionally automatic)
 // additional information
+// file isn't copied, it must stay valid, like __FILE__
 void LogInfoExplicit(log_streams_t s, const char *file, int line, const char *str);
 #define LOG_INFO(s, str) LogInfoExplicit((s), __FILE__, __LINE__, (str))
 
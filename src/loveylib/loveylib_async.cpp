@@ -0,0 +1,178 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/loveylib_async.cpp:
+ *  Asynchronous reads, and the IO threads they fall back to
+ *
+ ************************************************************/
+
+#include "loveylib/types.h"
+#include "loveylib/file.h"
+#include "loveylib/thread.h"
+#include "loveylib/atomic.h"
+#include "loveylib/assert.h"
+
+// IO threads used without platform async IO
+static constexpr const uptr ASYNC_IO_THREADS = 2;
+
+struct async_io_t {
+  // Set if reads are submitted to platform async IO
+  bfast platform;
+
+  thread_t threads[ASYNC_IO_THREADS];
+  uptr threadCount;
+
+  // Reads waiting for an IO thread, oldest first
+  light_mutex_t lock;
+  async_read_t *first, *last;
+
+  // Signalled once for every read queued, and
+  // once for every thread when quitting
+  semaphore_t wake;
+  std::atomic<bfast> quit;
+
+  std::atomic<uptr> inFlight;
+};
+
+static async_io_t s_async;
+
+// IO thread entry point
+static void IOThreadMain(void*) {
+  async_io_t *s = &s_async;
+
+  for (;;) {
+    WaitSema(&s->wake);
+    if (s->quit.load(std::memory_order_acquire)) return;
+
+    LockLightMutex(&s->lock);
+    async_read_t *r = s->first;
+    if (r) {
+      s->first = r->next;
+      if (!s->first) s->last = NULL;
+    }
+    UnlockLightMutex(&s->lock);
+
+    if (r) CompleteRead(r, ReadFileAt(r->file, r->out, r->size, r->offset));
+  }
+}
+
+bfast InitAsyncIO() {
+  async_io_t *s = &s_async;
+
+  InitLightMutex(&s->lock);
+  s->first = s->last = NULL;
+  s->threadCount = 0;
+  s->quit.store(false, std::memory_order_relaxed);
+  s->inFlight.store(0, std::memory_order_relaxed);
+
+  s->platform = InitPlatformAsyncIO();
+  if (s->platform) return true;
+
+  if (!CreateSema(&s->wake)) return false;
+
+  thread_attr_t attr = {};
+  attr.name = "IO thread";
+
+  for (; s->threadCount < ASYNC_IO_THREADS; ++s->threadCount)
+    if (!CreateThread(s->threads+s->threadCount, IOThreadMain, NULL, &attr)) break;
+
+  if (s->threadCount) return true;
+
+  DestroySema(&s->wake);
+  return false;
+}
+
+void FreeAsyncIO() {
+  async_io_t *s = &s_async;
+
+  while (s->inFlight.load(std::memory_order_acquire)) YieldThread();
+
+  if (s->platform) {
+    FreePlatformAsyncIO();
+    s->platform = false;
+  } else if (s->threadCount) {
+    s->quit.store(true, std::memory_order_release);
+    for (uptr i = 0; i < s->threadCount; ++i) SignalSema(&s->wake);
+
+    for (uptr i = 0; i < s->threadCount; ++i) {
+      WaitThread(s->threads+i);
+      DestroyThread(s->threads+i);
+    }
+
+    DestroySema(&s->wake);
+    s->threadCount = 0;
+  }
+}
+
+bfast SubmitRead(async_read_t *r, stream_t *file, void *out, uptr size, u64 offset) {
+  async_io_t *s = &s_async;
+  ASSERT(file->open());
+
+  if (s->inFlight.fetch_add(1, std::memory_order_relaxed) >= ASYNC_READ_MAX) {
+    s->inFlight.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  r->done.store(0, std::memory_order_relaxed);
+  r->result = 0;
+  r->file = file;
+  r->out = out;
+  r->size = size;
+  r->offset = offset;
+  r->next = NULL;
+
+  // Read right away if the platform won't take it
+  if (s->platform) {
+    if (!SubmitPlatformRead(r)) CompleteRead(r, ReadFileAt(file, out, size, offset));
+  } else if (s->threadCount) {
+    LockLightMutex(&s->lock);
+    if (s->last) s->last->next = r;
+    else s->first = r;
+    s->last = r;
+    UnlockLightMutex(&s->lock);
+
+    SignalSema(&s->wake);
+  } else CompleteRead(r, ReadFileAt(file, out, size, offset));
+
+  return true;
+}
+
+void CompleteRead(async_read_t *r, iptr result) {
+  // Not in flight anymore, so r can be submitted again
+  // as soon as it's done
+  s_async.inFlight.fetch_sub(1, std::memory_order_release);
+
+  r->result = result;
+  r->done.store(1, std::memory_order_release);
+  FutexWake(&r->done, true);
+}
+
+iptr WaitRead(async_read_t *r) {
+  while (!r->done.load(std::memory_order_acquire)) FutexWait(&r->done, 0);
+  return r->result;
+}
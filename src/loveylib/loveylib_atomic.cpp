@@ -0,0 +1,85 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/loveylib_atomic.cpp:
+ *  Lightweight synchronization primitives
+ *
+ ************************************************************/
+
+#include "loveylib/types.h"
+#include "loveylib/atomic.h"
+
+void LockLightMutexContended(light_mutex_t *m) {
+  // Spin while the owner is likely to let go soon
+  for (ufast i = 0; i < LIGHT_SPIN_COUNT; ++i) {
+    CpuRelax();
+
+    u32 unlocked = 0;
+    if ((m->state.load(std::memory_order_relaxed) == 0) &&
+        m->state.compare_exchange_weak(unlocked, 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+      return;
+  }
+
+  // Mark mutex as contended, then park until it's unlocked
+  // Once we're parked, we can't tell if anyone else is,
+  // so the mutex stays marked as contended
+  while (m->state.exchange(2, std::memory_order_acquire) != 0)
+    FutexWait(&m->state, 2);
+}
+
+void WaitLightEventContended(light_event_t *e) {
+  for (ufast i = 0; i < LIGHT_SPIN_COUNT; ++i) {
+    CpuRelax();
+
+    u32 set = 1;
+    if ((e->state.load(std::memory_order_relaxed) == 1) &&
+        e->state.compare_exchange_weak(set, 0, std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+      return;
+  }
+
+  for (;;) {
+    u32 state = e->state.load(std::memory_order_relaxed);
+
+    if (state == 1) {
+      if (e->state.compare_exchange_weak(state, 0, std::memory_order_acquire,
+                                         std::memory_order_relaxed))
+        return;
+      continue;
+    }
+
+    // Say we're about to park
+    if ((state == 0) &&
+        !e->state.compare_exchange_weak(state, 2, std::memory_order_relaxed,
+                                        std::memory_order_relaxed))
+      continue;
+
+    FutexWait(&e->state, 2);
+  }
+}
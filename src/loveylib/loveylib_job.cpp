@@ -0,0 +1,413 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/loveylib_job.cpp:
+ *  Job system
+ *
+ ************************************************************/
+
+#include "loveylib/types.h"
+#include "loveylib/job.h"
+#include "loveylib/thread.h"
+#include "loveylib/utils.h"
+#include "loveylib/assert.h"
+
+// Most workers, counting the thread that called InitJobs
+static constexpr const uptr JOB_MAX_WORKERS = 16;
+
+// Jobs per queue, must be a power of 2
+static constexpr const uptr JOB_QUEUE_SIZE = 1024;
+
+struct job_t {
+  job_func_t func;
+  void *data;
+  job_counter_t *counter;
+};
+
+// Job in a worker queue
+// Stealing threads read the job before they know they own it,
+// so every field is atomic
+struct job_slot_t {
+  std::atomic<job_func_t> func;
+  std::atomic<void*> data;
+  std::atomic<job_counter_t*> counter;
+};
+
+// Worker queue (Chase-Lev deque)
+// The owning worker pushes and pops jobs at bottom,
+// other workers steal jobs from top
+struct alignas(64) job_queue_t {
+  std::atomic<iptr> top;
+  alignas(64) std::atomic<iptr> bottom;
+
+  job_slot_t slots[JOB_QUEUE_SIZE];
+};
+
+struct job_system_t {
+  job_queue_t queues[JOB_MAX_WORKERS];
+
+  // Worker threads, threads[0] is unused
+  thread_t threads[JOB_MAX_WORKERS];
+
+  // Set before each worker thread is started,
+  // so workers can read it while others start
+  std::atomic<uptr> workerCount;
+
+  // Queue for jobs run from threads that aren't workers
+  mutex_t sharedLock;
+  job_t shared[JOB_QUEUE_SIZE];
+  uptr sharedFirst;
+  std::atomic<uptr> sharedCount;
+
+  // Signalled when jobs are run and workers are asleep
+  semaphore_t wake;
+  std::atomic<uptr> sleepers;
+
+  std::atomic<bfast> quit;
+};
+
+static job_system_t s_jobs;
+
+// Index of the calling thread's worker, -1 if it isn't a worker
+static thread_local iptr s_worker = -1;
+
+// Push job onto the calling worker's queue
+// Returns false if the queue is full
+static bfast PushJob(job_queue_t *q, const job_t *job) {
+  const iptr b = q->bottom.load(std::memory_order_relaxed);
+  const iptr t = q->top.load(std::memory_order_acquire);
+  if (b-t >= (iptr)JOB_QUEUE_SIZE) return false;
+
+  job_slot_t *s = q->slots + (b&(JOB_QUEUE_SIZE-1));
+  s->func.store(job->func, std::memory_order_relaxed);
+  s->data.store(job->data, std::memory_order_relaxed);
+  s->counter.store(job->counter, std::memory_order_relaxed);
+
+  std::atomic_thread_fence(std::memory_order_release);
+  q->bottom.store(b+1, std::memory_order_relaxed);
+
+  return true;
+}
+
+// Read job from slot
+static inline void ReadJob(const job_slot_t *s, job_t *out) {
+  out->func = s->func.load(std::memory_order_relaxed);
+  out->data = s->data.load(std::memory_order_relaxed);
+  out->counter = s->counter.load(std::memory_order_relaxed);
+}
+
+// Pop newest job off the calling worker's queue
+// Returns false if the queue is empty
+static bfast PopJob(job_queue_t *q, job_t *out) {
+  const iptr b = q->bottom.load(std::memory_order_relaxed)-1;
+  q->bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  iptr t = q->top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // Empty
+    q->bottom.store(b+1, std::memory_order_relaxed);
+    return false;
+  }
+
+  ReadJob(q->slots + (b&(JOB_QUEUE_SIZE-1)), out);
+  if (t < b) return true;
+
+  // Last job, race stealing threads for it
+  const bfast ret = q->top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+  q->bottom.store(b+1, std::memory_order_relaxed);
+  return ret;
+}
+
+// Steal oldest job from another worker's queue
+// Returns false if the queue is empty, or another
+// thread took the job first
+static bfast StealJob(job_queue_t *q, job_t *out) {
+  iptr t = q->top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const iptr b = q->bottom.load(std::memory_order_acquire);
+  if (t >= b) return false;
+
+  ReadJob(q->slots + (t&(JOB_QUEUE_SIZE-1)), out);
+  return q->top.compare_exchange_strong(t, t+1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+}
+
+// Take oldest job from the shared queue
+// Returns false if it's empty
+static bfast TakeSharedJob(job_system_t *s, job_t *out) {
+  if (!s->sharedCount.load(std::memory_order_acquire)) return false;
+
+  LockMutex(&s->sharedLock);
+
+  const uptr count = s->sharedCount.load(std::memory_order_relaxed);
+  if (count) {
+    *out = s->shared[s->sharedFirst];
+    s->sharedFirst = (s->sharedFirst+1)&(JOB_QUEUE_SIZE-1);
+    s->sharedCount.store(count-1, std::memory_order_relaxed);
+  }
+
+  UnlockMutex(&s->sharedLock);
+  return count != 0;
+}
+
+// Add job to the shared queue
+// Returns false if it's full
+static bfast PutSharedJob(job_system_t *s, const job_t *job) {
+  LockMutex(&s->sharedLock);
+
+  const uptr count = s->sharedCount.load(std::memory_order_relaxed);
+  if (count < JOB_QUEUE_SIZE) {
+    s->shared[(s->sharedFirst+count)&(JOB_QUEUE_SIZE-1)] = *job;
+    s->sharedCount.store(count+1, std::memory_order_release);
+  }
+
+  UnlockMutex(&s->sharedLock);
+  return count < JOB_QUEUE_SIZE;
+}
+
+// Run job, and mark it as done
+static inline void ExecuteJob(const job_t *job) {
+  job->func(job->data);
+  if (job->counter) job->counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+// Find a job and run it, worker is the calling thread's worker index
+// Returns false if there were no jobs to run
+static bfast RunNextJob(job_system_t *s, iptr worker) {
+  job_t job;
+
+  // Threads that aren't workers can only help with shared jobs
+  if (worker < 0) {
+    if (!TakeSharedJob(s, &job)) return false;
+
+    ExecuteJob(&job);
+    return true;
+  }
+
+  if (PopJob(s->queues+worker, &job) || TakeSharedJob(s, &job)) {
+    ExecuteJob(&job);
+    return true;
+  }
+
+  // Steal from the other workers, starting with the next one
+  const uptr workers = s->workerCount.load(std::memory_order_relaxed);
+  for (uptr i = 1; i < workers; ++i) {
+    const uptr victim = (worker+i)%workers;
+
+    if (StealJob(s->queues+victim, &job)) {
+      ExecuteJob(&job);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Check if any queue has jobs in it
+static bfast JobsQueued(job_system_t *s) {
+  if (s->sharedCount.load(std::memory_order_relaxed)) return true;
+
+  const uptr workers = s->workerCount.load(std::memory_order_relaxed);
+  for (uptr i = 0; i < workers; ++i) {
+    const iptr t = s->queues[i].top.load(std::memory_order_relaxed);
+    if (s->queues[i].bottom.load(std::memory_order_relaxed) > t) return true;
+  }
+
+  return false;
+}
+
+// Worker thread entry point
+static void WorkerMain(void *data) {
+  job_system_t *s = &s_jobs;
+  s_worker = (iptr)data;
+
+  while (!s->quit.load(std::memory_order_acquire)) {
+    if (RunNextJob(s, s_worker)) continue;
+
+    // Go to sleep, unless a job was run before
+    // we said we're asleep
+    s->sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!JobsQueued(s) && !s->quit.load(std::memory_order_seq_cst))
+      WaitSema(&s->wake);
+    s->sleepers.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+bfast InitJobs(uptr workerCount) {
+  job_system_t *s = &s_jobs;
+  ASSERT(s_worker < 0);
+
+  if (!workerCount) workerCount = GetProcessorCount();
+  if (workerCount > JOB_MAX_WORKERS) workerCount = JOB_MAX_WORKERS;
+
+  for (uptr i = 0; i < JOB_MAX_WORKERS; ++i) {
+    s->queues[i].top.store(0, std::memory_order_relaxed);
+    s->queues[i].bottom.store(0, std::memory_order_relaxed);
+  }
+
+  s->workerCount.store(1, std::memory_order_relaxed);
+  s->sharedFirst = 0;
+  s->sharedCount.store(0, std::memory_order_relaxed);
+  s->sleepers.store(0, std::memory_order_relaxed);
+  s->quit.store(false, std::memory_order_relaxed);
+
+  // The calling thread is worker 0
+  s_worker = 0;
+
+  if (workerCount < 2) return false;
+
+  if (CreateMutex(&s->sharedLock)) {
+    if (CreateSema(&s->wake)) {
+      thread_attr_t attr = {};
+      attr.name = "Job worker";
+
+      uptr started = 1;
+      for (; started < workerCount; ++started) {
+        s->workerCount.store(started+1, std::memory_order_relaxed);
+        if (!CreateThread(s->threads+started, WorkerMain, (void*)started, &attr)) break;
+      }
+
+      s->workerCount.store(started, std::memory_order_relaxed);
+      if (started > 1) return true;
+
+      DestroySema(&s->wake);
+    }
+
+    DestroyMutex(&s->sharedLock);
+  }
+
+  return false;
+}
+
+void FreeJobs() {
+  job_system_t *s = &s_jobs;
+  ASSERT(s_worker == 0);
+
+  const uptr workers = s->workerCount.load(std::memory_order_relaxed);
+  if (workers > 1) {
+    s->quit.store(true, std::memory_order_seq_cst);
+    for (uptr i = 1; i < workers; ++i) SignalSema(&s->wake);
+
+    for (uptr i = 1; i < workers; ++i) {
+      WaitThread(s->threads+i);
+      DestroyThread(s->threads+i);
+    }
+
+    DestroySema(&s->wake);
+    DestroyMutex(&s->sharedLock);
+  }
+
+  s->workerCount.store(1, std::memory_order_relaxed);
+  s_worker = -1;
+}
+
+uptr GetJobWorkerCount() {
+  return s_jobs.workerCount.load(std::memory_order_relaxed);
+}
+
+void RunJob(job_func_t func, void *data, job_counter_t *counter) {
+  job_system_t *s = &s_jobs;
+  const job_t job = {func, data, counter};
+
+  if (s->workerCount.load(std::memory_order_relaxed) > 1) {
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    const bfast queued = (s_worker >= 0) ? PushJob(s->queues+s_worker, &job) : PutSharedJob(s, &job);
+    if (queued) {
+      // Wake up a worker, if any are asleep
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (s->sleepers.load(std::memory_order_relaxed)) SignalSema(&s->wake);
+
+      return;
+    }
+
+    // Queue's full, run it now
+    ExecuteJob(&job);
+    return;
+  }
+
+  func(data);
+}
+
+void WaitJobs(job_counter_t *counter) {
+  job_system_t *s = &s_jobs;
+
+  while (counter->pending.load(std::memory_order_acquire)) {
+    if ((s->workerCount.load(std::memory_order_relaxed) < 2) || !RunNextJob(s, s_worker)) YieldThread();
+  }
+}
+
+// ParallelFor state, shared by every job helping with it
+struct parallel_for_t {
+  parallel_for_func_t func;
+  void *data;
+  uptr count, grain;
+
+  // Start of the next range to handle
+  std::atomic<uptr> next;
+};
+
+// ParallelFor job, handles ranges until there are none left
+static void ParallelForJob(void *data) {
+  parallel_for_t *p = (parallel_for_t*)data;
+
+  for (;;) {
+    const uptr begin = p->next.fetch_add(p->grain, std::memory_order_relaxed);
+    if (begin >= p->count) return;
+
+    const uptr end = (p->count-begin > p->grain) ? begin+p->grain : p->count;
+    p->func(p->data, begin, end);
+  }
+}
+
+void ParallelFor(uptr count, uptr grain, parallel_for_func_t func, void *data) {
+  if (!count) return;
+  if (!grain) grain = 1;
+
+  parallel_for_t p;
+  p.func = func;
+  p.data = data;
+  p.count = count;
+  p.grain = grain;
+  p.next.store(0, std::memory_order_relaxed);
+
+  // One job per worker, the calling thread is one of them
+  const uptr workers = GetJobWorkerCount();
+  uptr helpers = CeilDiv(count, grain);
+  if (helpers > workers) helpers = workers;
+
+  job_counter_t counter;
+  InitJobCounter(&counter);
+  for (uptr i = 1; i < helpers; ++i) RunJob(ParallelForJob, &p, &counter);
+
+  ParallelForJob(&p);
+  WaitJobs(&counter);
+}
@@ -36,9 +36,186 @@
 #include "loveylib/file.h"
 #include "loveylib/log.h"
 #include "loveylib/string.h"
+#include "loveylib/atomic.h"
+#include "loveylib/thread.h"
 
 #include <cstring>
 
+/*
+ * Logging threads only copy their message into a record in
+ * s_logRing, the log thread formats records and writes them
+ * out in batches. That way, logging from the audio or render
+ * thread never waits on the disk.
+ *
+ * The ring is a bounded multi-producer queue (Vyukov's). Each
+ * record has a sequence number saying whose turn it is, stored
+ * minus the record's index so a zeroed ring is empty. When the
+ * ring is full, messages are dropped and counted.
+ *
+ * Without a log thread, records are written out right away.
+ */
+
+// Log file writes are held back until this much is logged
+static constexpr const uptr LOG_FILE_BUFFER_SIZE = 4096;
+
+// Records in the ring, must be a power of 2
+static constexpr const uptr LOG_RING_SIZE = 256;
+
+// Longest file name written, longer ones keep their end
+static constexpr const uptr LOG_FILE_NAME_MAX = 255;
+
+// Log ring record header
+struct log_record_hdr_t {
+  // Turn of the record, minus its index
+  // pos = Free for the producer at pos
+  // pos+1 = Written by the producer at pos
+  std::atomic<u32> seq;
+
+  // Line in file, or -1 for a raw string
+  i32 line;
+  stream_t *streams;
+  const char *file;
+};
+
+// Size of a log ring record
+static constexpr const uptr LOG_RECORD_SIZE = 512;
+
+// Room for the message in a record, counting the terminator,
+// whatever the header leaves
+static constexpr const uptr LOG_RECORD_TEXT = LOG_RECORD_SIZE-sizeof(log_record_hdr_t);
+static_assert(LOG_RECORD_TEXT > LOG_MESSAGE_MAX, "");
+
+// Log ring record
+struct log_record_t {
+  log_record_hdr_t h;
+  char str[LOG_RECORD_TEXT];
+};
+static_assert(sizeof(log_record_t) == LOG_RECORD_SIZE, "");
+
+// Default log file, buffered by stream 2
+static stream_t s_logFile;
+static stream_buffer_t s_logBuffer;
+static u8 s_logBuf[LOG_FILE_BUFFER_SIZE];
+
+static log_record_t s_logRing[LOG_RING_SIZE];
+alignas(64) static std::atomic<u32> s_logHead; // Next record to write
+alignas(64) static u32 s_logTail; // Next record to read, guarded by s_logLock
+static std::atomic<u32> s_logDropped;
+static std::atomic<stream_t*> s_logDroppedStreams;
+
+// Only one thread reads the ring at a time, and buffered
+// streams can't be written from two threads at once
+static light_mutex_t s_logLock;
+
+// Log thread, woken when records are written
+static thread_t s_logThread;
+static light_event_t s_logWake;
+static std::atomic<bfast> s_logRunning;
+static std::atomic<bfast> s_logQuit;
+
+// Write formatted message to all open streams in s
+static void WriteLog(stream_t *s, const char *buf, uptr bufLen) {
+  for (stream_t *i = s+MAX_LOG_STREAMS; i-- != s;)
+    if (i->open()) i->f->write(i, buf, bufLen);
+}
+
+// Write out every record in the ring
+// s_logLock must be locked
+static void DrainLog() {
+  // File name, line, message and punctuation
+  char buf[LOG_FILE_NAME_MAX+LOG_RECORD_TEXT+32];
+
+  for (;;) {
+    log_record_t * const r = s_logRing + (s_logTail&(LOG_RING_SIZE-1));
+    const u32 turn = s_logTail - (s_logTail&(LOG_RING_SIZE-1));
+    if (r->h.seq.load(std::memory_order_acquire) != turn+1) break;
+
+    uptr bufLen;
+    if (r->h.line < 0) bufLen = format_buf_t(buf).s(r->str).s("\n").p - buf;
+    else {
+      const char *file = r->h.file;
+      const uptr fileLen = strlen(file);
+      if (fileLen > LOG_FILE_NAME_MAX) file += fileLen-LOG_FILE_NAME_MAX;
+
+      bufLen = format_buf_t(buf).s(file).s(", ").i(r->h.line).s(": ").s(r->str).s("\n").p - buf;
+    }
+
+    WriteLog(r->h.streams, buf, bufLen);
+
+    // Free record for the producer a lap later
+    r->h.seq.store(turn+LOG_RING_SIZE, std::memory_order_release);
+    ++s_logTail;
+  }
+
+  const u32 dropped = s_logDropped.exchange(0, std::memory_order_acquire);
+  if (dropped) {
+    const uptr bufLen =
+      format_buf_t(buf).s("(").i(dropped).s(" log messages dropped)\n").p - buf;
+
+    // Streams are the same for every message in practice
+    WriteLog(s_logDroppedStreams.load(std::memory_order_relaxed), buf, bufLen);
+  }
+}
+
+// Add record to the ring, then wake the log thread,
+// or write it out if there isn't one
+static void PushLog(log_streams_t s, const char *file, int line, const char *str) {
+  u32 pos = s_logHead.load(std::memory_order_relaxed);
+  log_record_t *r;
+
+  for (;;) {
+    r = s_logRing + (pos&(LOG_RING_SIZE-1));
+    const u32 turn = pos - (pos&(LOG_RING_SIZE-1));
+    const u32 seq = r->h.seq.load(std::memory_order_acquire);
+
+    if (seq == turn) {
+      // Record is free, try to take it
+      if (s_logHead.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed,
+                                          std::memory_order_relaxed))
+        break;
+    } else if ((i32)(seq-turn) < 0) {
+      // Ring is full, don't wait for the log thread
+      s_logDroppedStreams.store(s, std::memory_order_relaxed);
+      s_logDropped.fetch_add(1, std::memory_order_release);
+      return;
+    } else pos = s_logHead.load(std::memory_order_relaxed);
+  }
+
+  r->h.line = line;
+  r->h.streams = s;
+  r->h.file = file;
+
+  // Cut long messages short, marking them with "..."
+  const uptr len = strlen(str);
+  if (len > LOG_MESSAGE_MAX) {
+    memcpy(r->str, str, LOG_MESSAGE_MAX-3);
+    memcpy(r->str+LOG_MESSAGE_MAX-3, "...", 4);
+  } else memcpy(r->str, str, len+1);
+
+  r->h.seq.store(pos - (pos&(LOG_RING_SIZE-1)) + 1, std::memory_order_release);
+
+  if (s_logRunning.load(std::memory_order_acquire)) SetLightEvent(&s_logWake);
+  else {
+    LockLightMutex(&s_logLock);
+    DrainLog();
+    UnlockLightMutex(&s_logLock);
+  }
+}
+
+// Log thread entry point
+static void LogThreadMain(void *data) {
+  stream_t * const s = (stream_t*)data;
+
+  while (!s_logQuit.load(std::memory_order_acquire)) {
+    WaitLightEvent(&s_logWake);
+
+    LockLightMutex(&s_logLock);
+    DrainLog();
+    if (s[1].open()) FlushBufferedStream(&s[1]);
+    UnlockLightMutex(&s_logLock);
+  }
+}
+
 bfast OpenDefaultLogStreams(log_streams_t s) {
   bfast ret = false;
 
@@ -46,40 +223,54 @@ bfast OpenDefaultLogStreams(log_streams_t s) {
   ret = GetStandardOutput(&s[0]);
 
   // Stream 2 is a file
-  ret |= OpenFile(&s[1], "log.txt", FILE_WRITE_ONLY);
+  s_logFile.init();
+  if (OpenFile(&s_logFile, "log.txt", FILE_WRITE_ONLY)) {
+    OpenBufferedStream(&s[1], &s_logBuffer, &s_logFile, s_logBuf, sizeof(s_logBuf));
+    ret = true;
+  }
+
+  // Logs are written right away without a log thread
+  InitLightEvent(&s_logWake);
+  s_logQuit.store(false, std::memory_order_relaxed);
+
+  thread_attr_t attr = {};
+  attr.name = "Log thread";
+  s_logRunning.store(CreateThread(&s_logThread, LogThreadMain, s, &attr),
+                     std::memory_order_release);
 
   // If neither are open, return false
   return ret;
 }
 
 void CloseDefaultLogStreams(log_streams_t s) {
-  CloseFile(&s[1]);
-}
-
-void LogString(log_streams_t s, const char *str) {
-  // Fill buf with str + "\n"
-  char buf[256];
+  if (s_logRunning.load(std::memory_order_relaxed)) {
+    s_logQuit.store(true, std::memory_order_release);
+    SetLightEvent(&s_logWake);
 
-  // 256-1 so the following newline addition works
-  strncpy(buf, str, 255);
+    WaitThread(&s_logThread);
+    DestroyThread(&s_logThread);
+    s_logRunning.store(false, std::memory_order_release);
+  }
 
-  const uptr bufLen = strlen(buf)+1;
-  buf[bufLen-1] = '\n';
-  buf[bufLen] = 0;
+  LockLightMutex(&s_logLock);
+  DrainLog();
+  UnlockLightMutex(&s_logLock);
 
-  // Write buf to all streams in array
-  for (stream_t *i = s+MAX_LOG_STREAMS; i-- != s;)
-    if (i->open()) i->f->write(i, buf, bufLen);
+  CloseBufferedStream(&s[1]);
+  if (s_logFile.open()) CloseFile(&s_logFile);
 }
 
-void LogInfoExplicit(log_streams_t s, const char *file, int line, const char *str) {
-  // Fill buf with file + ", " + str(line) + ": " + str + "\n"
-  char buf[512];
+void FlushDefaultLogStreams(log_streams_t s) {
+  LockLightMutex(&s_logLock);
+  DrainLog();
+  if (s[1].open()) FlushBufferedStream(&s[1]);
+  UnlockLightMutex(&s_logLock);
+}
 
-  const uptr bufLen =
-    format_buf_t(buf).s(file).s(", ").i(line).s(": ").s(str).s("\n").p - buf;
+void LogString(log_streams_t s, const char *str) {
+  PushLog(s, NULL, -1, str);
+}
 
-  // Write buf to all streams in array
-  for (stream_t *i = s+MAX_LOG_STREAMS; i-- != s;)
-    if (i->open()) i->f->write(i, buf, bufLen);
+void LogInfoExplicit(log_streams_t s, const char *file, int line, const char *str) {
+  PushLog(s, file, line, str);
 }
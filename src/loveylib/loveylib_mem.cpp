@@ -36,6 +36,8 @@
 #include "loveylib/utils.h"
 #include "loveylib/heap.h"
 #include "loveylib/assert.h"
+#include "loveylib/string.h"
+#include "loveylib/log.h"
 
 #include <cstring>
 
@@ -67,7 +69,7 @@
  * Chunk size           ==================================
  */
 
-// Cache entry forward declaration
+// Free list links forward declaration
 struct free_arena_block_t;
 
 // Memory arena block header
@@ -75,7 +77,7 @@ static constexpr const uptr ARENA_BLOCK_HDR_SIZE = ARENA_ALIGNMENT;
 struct arena_block_hdr_t {
   arena_block_hdr_t *prev, *next; // Previous & next block
   uptr size; // Block size
-  free_arena_block_t *cache; // Pointer to cache entry, NULL if not in the cache
+  free_arena_block_t *links; // Free list links, NULL if not in a free list
 
   arena_alloc_flags_t flags; // Block flags
   bfast active; // Whether this block is active or not
@@ -91,25 +93,81 @@ struct arena_block_hdr_t {
 // At least a NULL terminator for a name must be stored in a block
 static_assert(ARENA_BLOCK_HDR_SIZE > sizeof(arena_block_hdr_t), "");
 
-// Size of free block cache
-// A bigger value uses more memory, but
-// msy make finding free blocks faster
-static constexpr const uptr MAX_FREE_BLOCKS = 7;
+const uptr ARENA_NAME_LENGTH = ARENA_BLOCK_HDR_SIZE - sizeof(arena_block_hdr_t) - 1;
 
-// Free block descriptor
+// Free list links
+// Stored in the data of free blocks, which is
+// always at least ARENA_ALIGNMENT bytes
 struct free_arena_block_t {
-  arena_block_hdr_t *addr;
-  uptr size;
+  arena_block_hdr_t *prevFree, *nextFree;
 };
 
+static_assert(sizeof(free_arena_block_t) <= ARENA_ALIGNMENT, "");
+
+/*
+ * Free blocks are kept in segregated free lists, indexed by
+ * a two-level size class (TLSF):
+ *
+ * The first level splits sizes into powers of 2, the second
+ * level splits each power of 2 into ARENA_SL_COUNT linear
+ * classes. Sizes below ARENA_SMALL_SIZE all go in first
+ * level 0, split linearly by ARENA_ALIGNMENT.
+ *
+ * A bitmap of non-empty lists is kept for each level, so
+ * finding a free block that fits is a couple of bit scans.
+ */
+
+// Number of second level classes, log2
+static constexpr const ufast ARENA_SL_LOG2 = 4;
+static constexpr const ufast ARENA_SL_COUNT = 1<<ARENA_SL_LOG2;
+
+// log2(ARENA_ALIGNMENT)
+static constexpr const ufast ARENA_ALIGNMENT_LOG2 = 6;
+static_assert((1<<ARENA_ALIGNMENT_LOG2) == ARENA_ALIGNMENT, "");
+
+// First level 0 holds sizes below ARENA_SMALL_SIZE
+static constexpr const ufast ARENA_FL_SHIFT = ARENA_SL_LOG2+ARENA_ALIGNMENT_LOG2;
+static constexpr const uptr ARENA_SMALL_SIZE = (uptr)1<<ARENA_FL_SHIFT;
+
+// Number of first level classes, enough for any size
+static constexpr const ufast ARENA_FL_COUNT = sizeof(uptr)*8 - ARENA_FL_SHIFT + 1;
+
+// Largest size that can be allocated, rounding it up
+// to the next size class must not overflow
+static constexpr const uptr ARENA_MAX_ALLOC = ((uptr)1<<(sizeof(uptr)*8 - 2));
+
+// Least amount of memory a growable arena commits at once
+static constexpr const uptr ARENA_GROW_SIZE = 1024*1024;
+
+// Smallest free block whose pages are given back to the OS,
+// with ARENA_RELEASE_BIT
+static constexpr const uptr ARENA_RELEASE_SIZE = 256*1024;
+
 // Memory arena header
 struct alignas(ARENA_ALIGNMENT) mem_arena_t {
-  // Free block cache, to potentially speed
-  // up allocation
-  free_arena_block_t freeBlocks[MAX_FREE_BLOCKS];
+  // Bit n set if first level n has any free blocks
+  uptr flBitmap;
+
+  // Bit n set if free list n in first level has any free blocks
+  u16 slBitmap[ARENA_FL_COUNT];
+
+  // Free lists
+  arena_block_hdr_t *freeLists[ARENA_FL_COUNT][ARENA_SL_COUNT];
+
+  // Statistics, except largestFree, which is found when asked for
+  arena_stats_t stats;
+
+  // Last block, grown into when the arena is grown
+  arena_block_hdr_t *last;
+
+  // Heap the arena is in, if it's growable
+  heap_t heap;
+  heap_flags_t heapFlags;
+  uptr pageSize;
+  arena_flags_t flags;
 
-  // Current free block pointer
-  free_arena_block_t *curFree;
+  // Memory committed on creation, never released
+  uptr keep;
 
   // First block
   inline arena_block_hdr_t *blockList() {
@@ -117,77 +175,75 @@ struct alignas(ARENA_ALIGNMENT) mem_arena_t {
   }
 };
 
+static_assert(sizeof(u16)*8 >= ARENA_SL_COUNT, "");
+
 // Blocks after header must be aligned
 static_assert((sizeof(mem_arena_t) & (ARENA_ALIGNMENT-1)) == 0, "");
 
-// Fill out free arena block
-static inline void FillFreeBlock(free_arena_block_t *ent, arena_block_hdr_t *blk) {
-  ASSERT(!blk->active);
-  ASSERT(ent);
-
-  ent->addr = blk;
-  ent->size = blk->size;
-  blk->cache = ent;
+// Get size class of size
+static inline void SizeClass(uptr size, ufast *fl, ufast *sl) {
+  if (size < ARENA_SMALL_SIZE) {
+    *fl = 0;
+    *sl = size >> ARENA_ALIGNMENT_LOG2;
+  } else {
+    const ufast bit = HighBit(size);
+    *fl = bit - (ARENA_FL_SHIFT-1);
+    *sl = (size >> (bit-ARENA_SL_LOG2)) ^ ARENA_SL_COUNT;
+  }
 }
 
-// Validate cache entry, if cache entry
-// is invalid it'll be nulled out
-#ifdef UNUSED
-static inline bptr ValidateCache(free_arena_block_t *free) {
-  ASSERT(free->addr);
-
-  if (free->addr->cache != free) free->addr->cache = NULL;
+// Add block to its free list
+static void AddFreeBlock(mem_arena_t *a, arena_block_hdr_t *blk) {
+  ASSERT(!blk->active);
+  ASSERT(!blk->links);
 
-  return (bptr)free->addr->cache;
-}
-#endif  //UNUSED
+  ufast fl, sl;
+  SizeClass(blk->size, &fl, &sl);
 
-// Same thing, but for block
-static inline bptr ValidateCache(arena_block_hdr_t *blk) {
-  if (blk->cache && blk->cache->addr != blk) blk->cache = NULL;
+  free_arena_block_t *links = (free_arena_block_t*)blk->data();
+  arena_block_hdr_t *head = a->freeLists[fl][sl];
 
-  return (bptr)blk->cache;
-}
+  links->prevFree = NULL;
+  links->nextFree = head;
+  if (head) head->links->prevFree = blk;
 
-// Add block to free block cache
-static void AddFreeBlock(mem_arena_t *a, arena_block_hdr_t *blk) {
-  ASSERT(!blk->cache);
+  blk->links = links;
+  a->freeLists[fl][sl] = blk;
 
-  FillFreeBlock(a->curFree++, blk);
+  a->flBitmap |= (uptr)1<<fl;
+  a->slBitmap[fl] |= 1<<sl;
 
-  // Wrap around
-  if (a->curFree >= ArrayEnd(a->freeBlocks))
-    a->curFree = a->freeBlocks;
+  a->stats.freeBytes += blk->size;
+  ++a->stats.freeBlocks;
 }
 
-// Remove block from free block cache
+// Remove block from its free list
 static void RemoveFreeBlock(mem_arena_t *a, arena_block_hdr_t *blk) {
-  // Make sure cache entry is valid before removing it
-  if (ValidateCache(blk)) {
-    // Cache entries with size 0 will be ignored
-    blk->cache->size = 0;
+  ASSERT(blk->links);
 
-    // If curFree isn't already on a free position,
-    // put it here
-    if (a->curFree->size != 0) a->curFree = blk->cache;
+  free_arena_block_t *links = blk->links;
+  if (links->nextFree) links->nextFree->links->prevFree = links->prevFree;
 
-    // Block isn't in cache anymore
-    blk->cache = NULL;
-  }
-}
+  if (links->prevFree) links->prevFree->links->nextFree = links->nextFree;
+  else {
+    // This block was the list head
+    ufast fl, sl;
+    SizeClass(blk->size, &fl, &sl);
 
-// Replace a block from free block cache
-static void ReplaceFreeBlock(arena_block_hdr_t *oldBlk,
-                             arena_block_hdr_t *newBlk)
-{
-  ASSERT(!newBlk->active);
-  ASSERT(!newBlk->cache);
+    ASSERT(a->freeLists[fl][sl] == blk);
+    a->freeLists[fl][sl] = links->nextFree;
+
+    // Update bitmaps if the list is empty now
+    if (!links->nextFree) {
+      a->slBitmap[fl] &= ~(1<<sl);
+      if (!a->slBitmap[fl]) a->flBitmap &= ~((uptr)1<<fl);
+    }
+  }
 
-  // Make sure cache entry is valid
-  if (!ValidateCache(oldBlk)) return;
+  blk->links = NULL;
 
-  FillFreeBlock(oldBlk->cache, newBlk);
-  oldBlk->cache = NULL;
+  a->stats.freeBytes -= blk->size;
+  --a->stats.freeBlocks;
 }
 
 bfast InitMemoryArena(mem_arena_t *hdr, uptr size) {
@@ -195,7 +251,7 @@ bfast InitMemoryArena(mem_arena_t *hdr, uptr size) {
   size = AlignDownMask(size, ARENA_ALIGNMENT-1);
 
   // If this chunk isn't big enough for a memory arena, fail
-  if (size <= sizeof(mem_arena_t) + ARENA_BLOCK_HDR_SIZE)
+  if (size < sizeof(mem_arena_t) + ARENA_BLOCK_HDR_SIZE + ARENA_ALIGNMENT)
     return false;
 
   // Setup arena
@@ -206,46 +262,142 @@ bfast InitMemoryArena(mem_arena_t *hdr, uptr size) {
 
   blockHdr->size = size - (sizeof(mem_arena_t) +
                            ARENA_BLOCK_HDR_SIZE);
-  blockHdr->cache = hdr->freeBlocks;
+  hdr->stats.size = hdr->stats.reserved = size - sizeof(mem_arena_t);
+  hdr->last = blockHdr;
 
-  // Setup free blocks
-  hdr->freeBlocks[0].addr = blockHdr;
-  hdr->freeBlocks[0].size = blockHdr->size;
-  hdr->curFree = &hdr->freeBlocks[1];
+  // Setup free lists
+  AddFreeBlock(hdr, blockHdr);
 
   // This was a success
   return true;
 }
 
-// Find a free block
+// Find a free block of at least size bytes
 static arena_block_hdr_t *FindFreeBlock(mem_arena_t *arena, uptr size) {
-  // First, search through cache
-  for (free_arena_block_t *i = arena->freeBlocks;
-       i != ArrayEnd(arena->freeBlocks); ++i)
-  {
-    if (i->size >= size) return i->addr;
+  // Round size up to the next size class, so any block
+  // in the class we start searching at is big enough
+  if (size >= ARENA_SMALL_SIZE)
+    size += ((uptr)1 << (HighBit(size)-ARENA_SL_LOG2)) - 1;
+
+  ufast fl, sl;
+  SizeClass(size, &fl, &sl);
+
+  // Search for free list in this first level
+  u16 slMap = arena->slBitmap[fl] & (0xffff << sl);
+  if (!slMap) {
+    // Search for first level with free blocks
+    const uptr flMap = arena->flBitmap & (~(uptr)0 << (fl+1));
+
+    // No block was found!
+    if (!flMap) return NULL;
+
+    fl = LowBit(flMap);
+    slMap = arena->slBitmap[fl];
+  }
+
+  sl = LowBit(slMap);
+  return arena->freeLists[fl][sl];
+}
+
+mem_arena_t *CreateGrowableArena(uptr reserve, uptr commit, arena_flags_t flags) {
+  const uptr pageSize = GetPageSize();
+  if (pageSize < ARENA_ALIGNMENT) return NULL;
+
+  reserve = AlignUpPow2(reserve, pageSize);
+
+  // Commit at least enough for the arena header and the first block
+  const uptr minCommit = sizeof(mem_arena_t) + ARENA_BLOCK_HDR_SIZE + ARENA_GROW_SIZE;
+  commit = AlignUpPow2((commit > minCommit) ? commit : minCommit, pageSize);
+  if (reserve < commit) return NULL;
+
+  heap_flags_t heapFlags = 0;
+  if (flags & ARENA_PREFAULT_BIT) heapFlags |= HEAP_PREFAULT_BIT;
+  if (flags & ARENA_HUGE_PAGES_BIT) heapFlags |= HEAP_HUGE_PAGES_BIT;
+
+  heap_t heap = ReserveHeap(reserve, heapFlags);
+  if (!heap) return NULL;
+
+  mem_arena_t *ret = (mem_arena_t*)heap;
+  if (!CommitHeap(heap, 0, commit, heapFlags) || !InitMemoryArena(ret, commit)) {
+    DestroyHeap(heap);
+    return NULL;
   }
 
-  // Nothing found in the cache, looks like we gotta do a slow search
-  for (arena_block_hdr_t *i = arena->blockList();
-       i; i = i->next)
-  {
-    if (!i->active && (i->size >= size)) return i;
+  ret->stats.reserved = reserve - sizeof(mem_arena_t);
+  ret->heap = heap;
+  ret->heapFlags = heapFlags;
+  ret->pageSize = pageSize;
+  ret->flags = flags;
+  ret->keep = commit;
+
+  return ret;
+}
+
+void DestroyGrowableArena(mem_arena_t *arena) {
+  ASSERT(arena->heap);
+  DestroyHeap(arena->heap);
+}
+
+// Commit more memory at the end of a growable arena, so
+// there's a free block of at least size bytes
+// Returns the free block, or NULL on failure
+static arena_block_hdr_t *GrowArena(mem_arena_t *arena, uptr size) {
+  arena_block_hdr_t *last = arena->last;
+
+  // Grow the last block if it's free, otherwise
+  // add a new block after it
+  uptr need = size + ARENA_BLOCK_HDR_SIZE;
+  if (!last->active) need = (last->size < size) ? size - last->size : 0;
+
+  uptr grow = AlignUpPow2((need > ARENA_GROW_SIZE) ? need : ARENA_GROW_SIZE, arena->pageSize);
+  const uptr left = arena->stats.reserved - arena->stats.size;
+  if (grow > left) grow = left;
+  if (!grow || (grow < need)) return NULL;
+
+  const uptr end = sizeof(mem_arena_t) + arena->stats.size;
+  if (!CommitHeap(arena->heap, end, grow, arena->heapFlags)) return NULL;
+  arena->stats.size += grow;
+
+  if (!last->active) {
+    RemoveFreeBlock(arena, last);
+    last->size += grow;
+  } else {
+    arena_block_hdr_t *blk = (arena_block_hdr_t*)((u8*)arena + end);
+    memset(blk, 0, sizeof(arena_block_hdr_t));
+
+    blk->prev = last;
+    blk->size = grow - ARENA_BLOCK_HDR_SIZE;
+    last->next = blk;
+    arena->last = last = blk;
   }
 
-  // No block was found!
-  return NULL;
+  AddFreeBlock(arena, last);
+
+  // The last block may still be smaller than the size
+  // class FindFreeBlock searches for
+  return (last->size >= size) ? last : NULL;
 }
 
 void *Alloc(mem_arena_t *arena, uptr size,
             const char *name, arena_alloc_flags_t flags)
 {
-  // TODO: Ignoring name for now
-  (void)name;
+  // Find free block, growing the arena if there isn't one
+  // Sizes are checked before aligning them, so they can't wrap
+  arena_block_hdr_t *free = NULL;
+  if (size <= ARENA_MAX_ALLOC) {
+    // Free blocks must be able to hold free list links
+    size = AlignUpPow2(size ? size : 1, ARENA_ALIGNMENT);
+
+    free = FindFreeBlock(arena, size);
+    if (!free && arena->heap) free = GrowArena(arena, size);
+  }
+
+  if (!free) {
+    ++arena->stats.failedAllocs;
+    return NULL;
+  }
 
-  // Find free block
-  arena_block_hdr_t *free = FindFreeBlock(arena, size);
-  if (!free) return NULL;
+  RemoveFreeBlock(arena, free);
 
   // Setup block
   free->active = true;
@@ -254,7 +406,6 @@ void *Alloc(mem_arena_t *arena, uptr size,
   // If user-supplied size and block size differ by
   // 2 or more block headers, add free block
   if (free->size - size >= ARENA_BLOCK_HDR_SIZE*2) {
-    size = AlignUpPow2(size, ARENA_ALIGNMENT);
     arena_block_hdr_t *next = (arena_block_hdr_t*)((u8*)free->data() + size);
 
     // Setup next block
@@ -263,19 +414,26 @@ void *Alloc(mem_arena_t *arena, uptr size,
     next->prev = free;
     next->next = free->next;
     next->size = free->size - size - ARENA_BLOCK_HDR_SIZE;
-    next->cache = NULL;
+    if (next->next) next->next->prev = next;
 
     // Set next block and new size
     free->size = size;
     free->next = next;
+    if (arena->last == free) arena->last = next;
 
-    // Replace this block in the cache
-    ReplaceFreeBlock(free, free->next);
-  } else {
-    // Remove this block from the cache
-    RemoveFreeBlock(arena, free);
+    AddFreeBlock(arena, next);
   }
 
+  // Store name, truncating it if it's too long
+  uptr nameLen = strlen(name);
+  if (nameLen > ARENA_NAME_LENGTH) nameLen = ARENA_NAME_LENGTH;
+  memcpy(free->name(), name, nameLen);
+  free->name()[nameLen] = 0;
+
+  arena->stats.used += free->size;
+  if (arena->stats.used > arena->stats.peak) arena->stats.peak = arena->stats.used;
+  ++arena->stats.allocs;
+
   return free->data();
 }
 
@@ -285,11 +443,10 @@ static inline arena_block_hdr_t *GetArenaBlock(void *addr) {
 }
 
 // Concatenate 2 free blocks (a < b)
-static arena_block_hdr_t *ConcatBlocks(mem_arena_t *arena, arena_block_hdr_t *a,
-                                       arena_block_hdr_t *b)
-{
-  ASSERT(!a->active);
-  ASSERT(!b->active);
+// Neither block can be in a free list
+static arena_block_hdr_t *ConcatBlocks(arena_block_hdr_t *a, arena_block_hdr_t *b) {
+  ASSERT(!a->active && !a->links);
+  ASSERT(!b->active && !b->links);
   ASSERT(a->next == b);
   ASSERT(b->prev == a);
 
@@ -300,29 +457,163 @@ static arena_block_hdr_t *ConcatBlocks(mem_arena_t *arena, arena_block_hdr_t *a,
   a->next = b->next;
   if (a->next) a->next->prev = a;
 
-  // Update a's cache entry
-  if (ValidateCache(a))
-    a->cache->size = a->size;
+  return a;
+}
+
+// Give pages in [start, end) of free block back to the OS,
+// except the page holding its free list links
+// Pages partly in the range are given back too, as long as
+// they're completely in the block
+static void ReleaseBlock(mem_arena_t *arena, arena_block_hdr_t *blk, uptr start, uptr end) {
+  uptr first = AlignUpPow2((uptr)(blk->links+1), arena->pageSize);
+  uptr last = AlignDownPow2((uptr)blk->data() + blk->size, arena->pageSize);
 
-  // Remove b from the cache
-  RemoveFreeBlock(arena, b);
+  if (first < (uptr)arena->heap + arena->keep) first = (uptr)arena->heap + arena->keep;
 
-  return a;
+  start = AlignDownPow2(start, arena->pageSize);
+  end = AlignUpPow2(end, arena->pageSize);
+  if (start < first) start = first;
+  if (end > last) end = last;
+
+  if (end > start) ResetHeap(arena->heap, start - (uptr)arena->heap, end-start);
 }
 
+/*
+ * With ARENA_RELEASE_BIT, every free block of at least
+ * ARENA_RELEASE_SIZE has already been given back, except its
+ * first page. When a block is freed, only the part of the
+ * merged block that hasn't been is given back: the block
+ * itself, and any smaller free neighbours it's merged with.
+ */
 void Free(mem_arena_t *arena, void *addr) {
   // Get block from void*
   arena_block_hdr_t *blk = GetArenaBlock(addr);
+  ASSERT(blk->active);
 
   // This block is now free
   blk->active = false;
+
+  arena->stats.used -= blk->size;
+  --arena->stats.allocs;
+
+  // Part of the merged block that hasn't been given back yet
+  uptr start = (uptr)blk->data();
+  uptr end = start + blk->size;
+
+  // If previous block is free, concatenate
+  if (blk->prev && !blk->prev->active) {
+    arena_block_hdr_t *prev = blk->prev;
+    start = (prev->size >= ARENA_RELEASE_SIZE) ? (uptr)blk : (uptr)prev->data();
+
+    RemoveFreeBlock(arena, prev);
+    if (arena->last == blk) arena->last = prev;
+    blk = ConcatBlocks(prev, blk);
+  }
+
+  // If next block is free, concatenate
+  if (blk->next && !blk->next->active) {
+    arena_block_hdr_t *next = blk->next;
+    end = (next->size >= ARENA_RELEASE_SIZE) ?
+      (uptr)next->data() + sizeof(free_arena_block_t) :
+      (uptr)next->data() + next->size;
+
+    RemoveFreeBlock(arena, next);
+    if (arena->last == next) arena->last = blk;
+    blk = ConcatBlocks(blk, next);
+  }
+
   AddFreeBlock(arena, blk);
 
-  // While previous block is free, concatenate
-  if (blk->prev && !blk->prev->active)
-    blk = ConcatBlocks(arena, blk->prev, blk);
+  if ((arena->flags & ARENA_RELEASE_BIT) && (blk->size >= ARENA_RELEASE_SIZE))
+    ReleaseBlock(arena, blk, start, end);
+}
+
+// Find largest free block size
+static uptr LargestFreeBlock(mem_arena_t *arena) {
+  if (!arena->flBitmap) return 0;
+
+  // Only the highest non-empty free list has to be searched,
+  // blocks in lower lists are all smaller
+  const ufast fl = HighBit(arena->flBitmap);
+  const ufast sl = HighBit(arena->slBitmap[fl]);
+
+  uptr ret = 0;
+  for (arena_block_hdr_t *i = arena->freeLists[fl][sl]; i; i = i->links->nextFree)
+    if (i->size > ret) ret = i->size;
+
+  return ret;
+}
+
+void GetArenaStats(mem_arena_t *arena, arena_stats_t *out) {
+  *out = arena->stats;
+  out->largestFree = LargestFreeBlock(arena);
+}
+
+// Maximum number of names DumpArena reports separately,
+// the rest are reported together
+static constexpr const uptr MAX_DUMP_NAMES = 32;
+
+// Allocations with the same name
+struct arena_name_stats_t {
+  const char *name;
+  uptr allocs, bytes;
+};
+
+void DumpArena(mem_arena_t *arena, log_streams_t s) {
+  arena_stats_t stats;
+  GetArenaStats(arena, &stats);
+
+  arena_name_stats_t names[MAX_DUMP_NAMES+1];
+  uptr nameCount = 0;
+  names[MAX_DUMP_NAMES].name = "(other)";
+  names[MAX_DUMP_NAMES].allocs = names[MAX_DUMP_NAMES].bytes = 0;
+
+  // Walk block list, grouping allocations by name
+  uptr blocks = 0, freeBlocks = 0, freeBytes = 0;
+  for (arena_block_hdr_t *i = arena->blockList(); i; i = i->next) {
+    ++blocks;
+
+    if (!i->active) {
+      ++freeBlocks;
+      freeBytes += i->size;
+      continue;
+    }
+
+    arena_name_stats_t *n = names;
+    while ((n != names+nameCount) && strcmp(n->name, i->name())) ++n;
+
+    if (n == names+nameCount) {
+      if (nameCount < MAX_DUMP_NAMES) {
+        n->name = i->name();
+        n->allocs = n->bytes = 0;
+        ++nameCount;
+      } else n = names+MAX_DUMP_NAMES;
+    }
+
+    ++n->allocs;
+    n->bytes += i->size;
+  }
+
+  ASSERT(freeBlocks == stats.freeBlocks);
+  ASSERT(freeBytes == stats.freeBytes);
+
+  // Fragmentation is the percentage of free memory that
+  // can't be allocated in one block
+  const uptr frag = stats.freeBytes ? 100 - stats.largestFree*100/stats.freeBytes : 0;
 
-  // While next block is free, concatenate
-  if (blk->next && !blk->next->active)
-    blk = ConcatBlocks(arena, blk, blk->next);
+  char line[256];
+  LogString(s, format_buf_t(line).s("Arena: ").i(stats.used).s('/').i(stats.size)
+            .s(" bytes used (").i(stats.reserved).s(" reserved), peak ").i(stats.peak).s(", ").i(stats.allocs)
+            .s(" allocations, ").i(stats.failedAllocs).s(" failed").str(line));
+  LogString(s, format_buf_t(line).s("Arena: ").i(stats.freeBytes).s(" bytes free in ")
+            .i(stats.freeBlocks).s(" of ").i(blocks).s(" blocks, largest ")
+            .i(stats.largestFree).s(", ").i(frag).s("% fragmented").str(line));
+
+  // Other names go last
+  if (names[MAX_DUMP_NAMES].allocs) names[nameCount++] = names[MAX_DUMP_NAMES];
+
+  for (const arena_name_stats_t *n = names; n != names+nameCount; ++n) {
+    LogString(s, format_buf_t(line).s("  ").s(*n->name ? n->name : "(unnamed)").s(": ")
+              .i(n->allocs).s(" allocations, ").i(n->bytes).s(" bytes").str(line));
+  }
 }
@@ -0,0 +1,265 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of LoveyLib
+ *
+ * src/loveylib/loveylib_stream.cpp:
+ *  Buffered and memory streams
+ *
+ ************************************************************/
+
+#include "loveylib/types.h"
+#include "loveylib/stream.h"
+#include "loveylib/assert.h"
+
+#include <cstring>
+
+// Get buffered stream state
+static inline stream_buffer_t *GetBuffer(const stream_t *s) {
+  return *(stream_buffer_t**)s->data;
+}
+
+// Give back read ahead data, so the underlying
+// stream is where the buffered stream is
+// Returns false on error
+static bfast DropReadAhead(stream_buffer_t *b) {
+  if (!b->end) return true;
+
+  const uptr ahead = b->end-b->pos;
+  b->pos = b->end = 0;
+
+  if (!ahead) return true;
+  return b->base->f->seek(b->base, -(iptr)ahead, ORIGIN_CUR);
+}
+
+// Write held back data
+// Returns false on error
+static bfast FlushWrites(stream_buffer_t *b) {
+  if (b->end || !b->pos) return true;
+
+  const iptr ret = b->base->f->write(b->base, b->buf, b->pos);
+  if (ret < (iptr)b->pos) {
+    // Keep what wasn't written, so it's written next time
+    if (ret > 0) {
+      memmove(b->buf, b->buf+ret, b->pos-ret);
+      b->pos -= ret;
+    }
+
+    return false;
+  }
+
+  b->pos = 0;
+  return true;
+}
+
+static iptr BufferedRead(stream_t *s, void *out, uptr size) {
+  stream_buffer_t *b = GetBuffer(s);
+  if (!FlushWrites(b)) return -1;
+
+  u8 *dst = (u8*)out;
+  uptr read = 0;
+
+  while (read < size) {
+    // Take read ahead data first
+    uptr avail = b->end-b->pos;
+    if (avail) {
+      if (avail > size-read) avail = size-read;
+
+      memcpy(dst+read, b->buf+b->pos, avail);
+      b->pos += avail;
+      read += avail;
+      continue;
+    }
+
+    b->pos = b->end = 0;
+
+    // Read big requests directly
+    if (size-read >= b->size) {
+      const iptr ret = b->base->f->read(b->base, dst+read, size-read);
+      if (ret < 0) return read ? (iptr)read : -1;
+
+      read += ret;
+      break;
+    }
+
+    const iptr ret = b->base->f->read(b->base, b->buf, b->size);
+    if (ret < 0) return read ? (iptr)read : -1;
+    if (!ret) break;
+
+    b->end = ret;
+  }
+
+  return read;
+}
+
+static iptr BufferedWrite(stream_t *s, const void *in, uptr size) {
+  stream_buffer_t *b = GetBuffer(s);
+  if (!DropReadAhead(b)) return -1;
+
+  // Flush if it doesn't fit
+  if (size > b->size-b->pos) {
+    if (!FlushWrites(b)) return -1;
+
+    // Write big requests directly
+    if (size >= b->size) return b->base->f->write(b->base, in, size);
+  }
+
+  memcpy(b->buf+b->pos, in, size);
+  b->pos += size;
+
+  return size;
+}
+
+static bfast BufferedSeek(stream_t *s, iptr pos, stream_origin_t origin) {
+  stream_buffer_t *b = GetBuffer(s);
+
+  // Seek within read ahead data, if possible
+  if ((origin == ORIGIN_CUR) && b->end) {
+    const iptr target = (iptr)b->pos+pos;
+    if ((target >= 0) && (target <= (iptr)b->end)) {
+      b->pos = target;
+      return true;
+    }
+  }
+
+  if (!FlushWrites(b)) return false;
+
+  // The underlying stream is ahead of us by the read ahead data
+  if (origin == ORIGIN_CUR) pos -= b->end-b->pos;
+  b->pos = b->end = 0;
+
+  return b->base->f->seek(b->base, pos, origin);
+}
+
+static iptr BufferedTell(const stream_t *s) {
+  const stream_buffer_t *b = GetBuffer(s);
+
+  const iptr ret = b->base->f->tell(b->base);
+  if (ret < 0) return -1;
+
+  // Account for read ahead or held back data
+  if (b->end) return ret-(iptr)(b->end-b->pos);
+  return ret+b->pos;
+}
+
+static const stream_funcs_t S_BufferedFuncs = {
+  BufferedRead,
+  BufferedWrite,
+  BufferedSeek,
+  BufferedTell
+};
+
+void OpenBufferedStream(stream_t *out, stream_buffer_t *b, stream_t *base,
+                        void *buf, uptr size)
+{
+  ASSERT(base->open());
+  ASSERT(size > 0);
+
+  b->base = base;
+  b->buf = (u8*)buf;
+  b->size = size;
+  b->pos = b->end = 0;
+
+  out->f = &S_BufferedFuncs;
+  *(stream_buffer_t**)out->data = b;
+}
+
+bfast FlushBufferedStream(stream_t *s) {
+  return FlushWrites(GetBuffer(s));
+}
+
+void CloseBufferedStream(stream_t *s) {
+  if (!s->open()) return;
+
+  FlushWrites(GetBuffer(s));
+  s->init();
+}
+
+///////////////////////
+// Memory streams
+
+struct memory_stream_t {
+  const u8 *data;
+  uptr size, pos;
+};
+static_assert(sizeof(memory_stream_t) <= sizeof(stream_t::data), "");
+
+// Get memory stream state
+static inline memory_stream_t *GetMemory(stream_t *s) {
+  return (memory_stream_t*)s->data;
+}
+
+static iptr MemoryRead(stream_t *s, void *out, uptr size) {
+  memory_stream_t *m = GetMemory(s);
+
+  if (size > m->size-m->pos) size = m->size-m->pos;
+  if (!size) return 0;
+
+  memcpy(out, m->data+m->pos, size);
+  m->pos += size;
+
+  return size;
+}
+
+static iptr MemoryWrite(stream_t*, const void*, uptr) {
+  return -1;
+}
+
+static bfast MemorySeek(stream_t *s, iptr pos, stream_origin_t origin) {
+  memory_stream_t *m = GetMemory(s);
+
+  switch (origin) {
+  case ORIGIN_SET: break;
+  case ORIGIN_END: pos += m->size; break;
+  case ORIGIN_CUR: pos += m->pos; break;
+  default: return false;
+  }
+
+  if ((pos < 0) || ((uptr)pos > m->size)) return false;
+
+  m->pos = pos;
+  return true;
+}
+
+static iptr MemoryTell(const stream_t *s) {
+  return ((const memory_stream_t*)s->data)->pos;
+}
+
+static const stream_funcs_t S_MemoryFuncs = {
+  MemoryRead,
+  MemoryWrite,
+  MemorySeek,
+  MemoryTell
+};
+
+void OpenMemoryStream(stream_t *out, const void *data, uptr size) {
+  memory_stream_t *m = GetMemory(out);
+  m->data = (const u8*)data;
+  m->size = size;
+  m->pos = 0;
+
+  out->f = &S_MemoryFuncs;
+}
@@ -34,54 +34,83 @@
 #include "loveylib/types.h"
 #include "loveylib/string.h"
 #include "loveylib/assert.h"
+#include "loveylib/utils.h"
 
 #include <cstring>
+#include <cfloat>
+
+// Powers of 10 that fit in a u64
+static const u64 S_Pow10[20] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull,
+  100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+  10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+  100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+  100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+// Every pair of digits, "00" to "99"
+static const char S_DigitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
 
 // Get number length
-// Only accepts positive integers
 uptr NumberLength(u64 n) {
-  uptr ret = 1;
-  u64 pow10 = 10;
+  // log10(n) ~= log2(n)*1233/4096, which is off by at most 1
+  // 0 has one digit, like 1
+  n |= 1;
+  const uptr t = ((HighBit(n)+1)*1233) >> 12;
+  return t + 1 - (n < S_Pow10[t]);
+}
+
+// Write last len digits of n, two at a time, ending at end
+static void WriteDigits(char *end, u64 n, uptr len) {
+  for (; len >= 2; len -= 2) {
+    const char *pair = S_DigitPairs + (n%100)*2;
+    n /= 100;
 
-  while (pow10 <= n) {
-    ++ret;
-    pow10 *= 10;
+    *--end = pair[1];
+    *--end = pair[0];
   }
 
-  return ret;
+  if (len) *--end = n%10 + '0';
 }
 
 char *IntegerToString(char *out, i64 num) {
+  // Negate as unsigned, so the lowest i64 works
+  u64 n = num;
   if (num < 0) {
     *out++ = '-';
-    num = -num;
+    n = 0-n;
   }
 
-  const uptr len = NumberLength(num);
+  const uptr len = NumberLength(n);
 
   // Set NULL terminator
   out[len] = 0;
 
-  // Loop over digits in number, writing to out
-  for (uptr i = len; i--; num /= 10)
-    out[i] = num%10 + '0';
-
+  WriteDigits(out+len, n, len);
   return out+len;
 }
 
 char *IntegerToString(char *out, i64 num, uptr len) {
+  u64 n = num;
   if (num < 0) {
     *out++ = '-';
-    num = -num;
+    n = 0-n;
   }
 
   // Set NULL terminator
   out[len] = 0;
 
-  // Loop over digits in number, writing to out
-  for (uptr i = len; i--; num /= 10)
-    out[i] = num%10 + '0';
-
+  WriteDigits(out+len, n, len);
   return out+len;
 }
 
@@ -104,20 +133,80 @@ i64 StringToInteger(const char *str) {
 }
 
 char *FloatToString(char *out, f32 num) {
+  if (num != num) {
+    memcpy(out, "nan", 4);
+    return out+3;
+  }
+
   if (num < 0.f) {
     *out++ = '-';
     num = -num;
   }
 
-  const i64 integer = num;
-  const i64 decimal = (num-(f32)integer)*1000000.f;
+  // Most numbers fit in fixed point with 6 decimal places, a double
+  // holds them exactly, so both parts come from one conversion
+  // Past 2^63/10^6 they don't fit an i64, so convert straight to u64
+  static_assert(1e13*1000000.0 < 18446744073709551616.0, "Fixed point doesn't fit u64");
+  if (num < 1e13f) {
+    const u64 fixed = (u64)((f64)num*1000000.0);
+    const u64 integer = fixed/1000000;
+    const uptr len = NumberLength(integer);
+
+    WriteDigits(out+len, integer, len);
+    out[len] = '.';
+    WriteDigits(out+len+7, fixed%1000000, 6);
+    out[len+7] = 0;
+
+    return out+len+7;
+  }
 
-  // Write integer part of number
-  out = IntegerToString(out, integer);
+  if (num > FLT_MAX) {
+    memcpy(out, "inf", 4);
+    return out+3;
+  }
+
+  // Floats this big have no decimal places
+  if (num < 18446744073709551616.f) {
+    const u64 integer = num;
+    const uptr len = NumberLength(integer);
+    WriteDigits(out+len, integer, len);
+    memcpy(out+len, ".000000", 8);
+
+    return out+len+7;
+  }
+
+  // Past 2^64, a float is it's mantissa times 2^exp, which is
+  // worked out exactly in base 10^18 parts, lowest first
+  static constexpr const u64 PART = 1000000000000000000ull;
+  static_assert(FLT_MAX < 1e54, "Float doesn't fit in 3 parts");
+
+  u32 bits;
+  memcpy(&bits, &num, sizeof(bits));
+
+  u64 parts[3] = {(bits&0x7fffff)|0x800000, 0, 0};
+  for (uptr exp = (bits>>23)-150; exp--;) {
+    u64 carry = 0;
+    for (uptr i = 0; i < 3; ++i) {
+      const u64 p = parts[i]*2 + carry;
+      carry = p >= PART;
+      parts[i] = p - carry*PART;
+    }
+  }
+
+  uptr top = 2;
+  while (!parts[top]) --top;
+
+  const uptr len = NumberLength(parts[top]);
+  WriteDigits(out+len, parts[top], len);
+  out += len;
+
+  while (top--) {
+    WriteDigits(out+18, parts[top], 18);
+    out += 18;
+  }
 
-  // Write decimal part of number
-  *out = '.';
-  return IntegerToString(out+1, decimal, 6);
+  memcpy(out, ".000000", 8);
+  return out+7;
 }
 
 f32 StringToFloat(const char *str) {
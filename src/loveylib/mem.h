@@ -36,6 +36,7 @@
 
 #include "loveylib/types.h"
 #include "loveylib/utils.h"
+#include "loveylib/log.h"
 
 // Return type for functions that return allocated memory
 // that require the caller to free them
@@ -71,19 +72,67 @@ enum arena_alloc_flags_e : ufast {
 };
 typedef ufast arena_alloc_flags_t;
 
+// Growable arena flags
+enum arena_flags_e : ufast {
+  // Give the pages of big free blocks back to the OS
+  // Memory committed when the arena was created is kept
+  ARENA_RELEASE_BIT = 1,
+
+  // Fault in memory when it's committed (HEAP_PREFAULT_BIT)
+  ARENA_PREFAULT_BIT = 2,
+
+  // Use huge pages where possible (HEAP_HUGE_PAGES_BIT)
+  ARENA_HUGE_PAGES_BIT = 4,
+};
+typedef ufast arena_flags_t;
+
 // Memory arena initialization
 bfast InitMemoryArena(mem_arena_t *out, uptr size);
 
+// Create memory arena in reserved address space
+// commit bytes are committed up front, after that memory is
+// committed as the arena needs it, up to reserve bytes
+//
+// Returns NULL on failure
+mem_arena_t *CreateGrowableArena(uptr reserve, uptr commit = 0, arena_flags_t flags = 0);
+
+// Destroy arena from CreateGrowableArena
+void DestroyGrowableArena(mem_arena_t *a);
+
 template<uptr size>
 static inline bfast InitMemoryArena(mem_arena_container_t<size> *out) {
   return InitMemoryArena((mem_arena_t*)out, size);
 }
 
+// Maximum length of a block name, longer names are truncated
+extern const uptr ARENA_NAME_LENGTH;
+
 // Allocate memory from memory arena
+// name is stored with the block, for DumpArena
 void *Alloc(mem_arena_t *a, uptr size,
             const char *name = "", arena_alloc_flags_t flags = 0);
 
 // Free memory in arena
 void Free(mem_arena_t *a, void *addr);
 
+// Memory arena statistics
+// Sizes don't include block headers
+struct arena_stats_t {
+  uptr size; // Size of block area
+  uptr reserved; // Size block area can grow to
+  uptr used, peak; // Bytes allocated, and most bytes ever allocated
+  uptr allocs; // Active allocations
+  uptr failedAllocs; // Allocations that couldn't be satisfied
+
+  uptr freeBytes, freeBlocks; // Free bytes, and number of free blocks
+  uptr largestFree; // Largest free block
+};
+
+// Get memory arena statistics
+void GetArenaStats(mem_arena_t *a, arena_stats_t *out);
+
+// Log statistics, allocations per name and fragmentation
+// of memory arena to s
+void DumpArena(mem_arena_t *a, log_streams_t s);
+
 #endif //_LOVEYLIB_MEM_H
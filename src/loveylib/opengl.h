@@ -151,6 +151,8 @@
                                                                         \
   T_OPENGL_FUNC_DEF(void, TexParameteri, ::gl::enum_t, ::gl::enum_t, ::gl::int_t) \
                                                                         \
+  T_OPENGL_FUNC_DEF(void, PixelStorei, ::gl::enum_t, ::gl::int_t)       \
+                                                                        \
   T_OPENGL_FUNC_DEF(void, Enable, ::gl::enum_t)                         \
                                                                         \
   T_OPENGL_FUNC_DEF(void, BlendFunc, ::gl::enum_t, ::gl::enum_t)        \
@@ -232,6 +234,7 @@ enum enum_e : enum_t {
   TEXTURE0 = 0x84c0,
   BGRA = 0x80e1,
   RGBA8 = 0x8058,
+  UNPACK_ROW_LENGTH = 0x0cf2,
   BLEND = 0x0be2,
   SRC_ALPHA = 0x0302,
   ONE_MINUS_SRC_ALPHA = 0x0303,
@@ -35,12 +35,25 @@
 #include "loveylib/stream.h"
 #include "loveylib/file.h"
 #include "loveylib/assert.h"
+#include "loveylib/heap.h"
+#include "loveylib_config.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 
+#ifdef LOVEYLIB_IO_URING
+#include "loveylib/thread.h"
+#include "loveylib/atomic.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
 // File stream
 struct file_stream_t {
   const stream_funcs_t *f;
@@ -139,3 +152,309 @@ void CloseFile(stream_t *f) {
   // Mark stream as closed
   i->f = NULL;
 }
+
+// Read whole file into a heap, for files that can't be mapped
+// Returns false on error
+static bfast ReadWholeFile(mapped_file_t *out, int fd, uptr size) {
+  u8 * const data = (u8*)InitHeap(size);
+  if (!data) return false;
+
+  for (uptr done = 0; done < size;) {
+    const ssize_t ret = read(fd, data+done, size-done);
+    if (ret <= 0) {
+      DestroyHeap(data);
+      return false;
+    }
+
+    done += ret;
+  }
+
+  out->data = data;
+  out->size = size;
+  out->mapped = false;
+
+  return true;
+}
+
+// Map file descriptor, the fd can be closed after
+// Returns false on error
+static bfast MapFd(mapped_file_t *out, int fd) {
+  struct stat st;
+  if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)) return false;
+
+  const uptr size = st.st_size;
+
+  if (!size) {
+    // Nothing to map
+    out->data = NULL;
+    out->size = 0;
+    out->mapped = false;
+
+    return true;
+  }
+
+  void * const data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) return ReadWholeFile(out, fd, size);
+
+  // The whole view is usually read right away
+  madvise(data, size, MADV_WILLNEED);
+
+  out->data = (const u8*)data;
+  out->size = size;
+  out->mapped = true;
+
+  return true;
+}
+
+bfast MapFile(mapped_file_t *out, const char *name) {
+  const int fd = open(name, O_RDONLY);
+  if (fd < 0) return false;
+
+  const bfast ret = MapFd(out, fd);
+
+  // The mapping stays valid without the fd
+  close(fd);
+  return ret;
+}
+
+bfast MapFile(mapped_file_t *out, stream_t *f) {
+  file_stream_t * const data = (file_stream_t*)f;
+  ASSERT(data->f == &S_FileFuncs);
+
+  return MapFd(out, data->fd);
+}
+
+void UnmapFile(mapped_file_t *file) {
+  if (file->mapped) munmap((void*)file->data, file->size);
+  else if (file->data) DestroyHeap((heap_t)file->data);
+
+  file->data = NULL;
+  file->size = 0;
+  file->mapped = false;
+}
+
+iptr ReadFileAt(stream_t *f, void *out, uptr size, u64 offset) {
+  file_stream_t * const data = (file_stream_t*)f;
+  ASSERT(f->open());
+
+  return pread(data->fd, out, size, offset);
+}
+
+#ifdef LOVEYLIB_IO_URING
+
+// io_uring instance
+struct uring_t {
+  int fd;
+
+  // Submission ring, guarded by lock
+  light_mutex_t lock;
+  void *sqRing;
+  uptr sqRingSize;
+  std::atomic<u32> *sqHead, *sqTail;
+  u32 sqMask;
+  u32 *sqArray;
+  io_uring_sqe *sqes;
+  uptr sqesSize;
+
+  // Completion ring, only touched by the reaper
+  // May be the same mapping as the submission ring
+  void *cqRing;
+  uptr cqRingSize;
+  std::atomic<u32> *cqHead, *cqTail;
+  u32 cqMask;
+  const io_uring_cqe *cqes;
+
+  // Waits for completions, and completes reads
+  thread_t reaper;
+};
+
+static uring_t s_uring;
+
+// Get pointer into ring
+template<typename T>
+static inline T *RingPtr(void *ring, u32 offset) {
+  return (T*)((u8*)ring + offset);
+}
+
+// Unmap rings and close io_uring
+static void CloseUring(uring_t *u) {
+  if (u->sqes) munmap(u->sqes, u->sqesSize);
+  if (u->cqRing && (u->cqRing != u->sqRing)) munmap(u->cqRing, u->cqRingSize);
+  if (u->sqRing) munmap(u->sqRing, u->sqRingSize);
+  close(u->fd);
+
+  u->sqes = NULL;
+  u->cqRing = u->sqRing = NULL;
+}
+
+// Map ring
+// Returns NULL on failure
+static void *MapRing(int fd, uptr size, u64 offset) {
+  void * const ret = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, offset);
+  return (ret != MAP_FAILED) ? ret : NULL;
+}
+
+// Add entry to the submission ring, and submit it
+// user_data is the async_read_t, or 0 to tell the reaper to quit
+// Returns false if the kernel wouldn't take the entry, it's
+// taken back out of the ring then
+static bfast PushUring(uring_t *u, u8 opcode, int fd, void *out, uptr size, u64 offset, u64 userData) {
+  ASSERT(size <= 0xffffffff);
+
+  LockLightMutex(&u->lock);
+
+  const u32 tail = u->sqTail->load(std::memory_order_relaxed);
+  const u32 index = tail&u->sqMask;
+
+  io_uring_sqe * const sqe = u->sqes+index;
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (u64)(uptr)out;
+  sqe->len = size;
+  sqe->off = offset;
+  sqe->user_data = userData;
+
+  u->sqArray[index] = index;
+  u->sqTail->store(tail+1, std::memory_order_release);
+
+  // Submit every entry the kernel hasn't taken yet
+  bfast ret = true;
+  for (;;) {
+    const u32 pending = tail+1 - u->sqHead->load(std::memory_order_acquire);
+    if (!pending || (syscall(__NR_io_uring_enter, u->fd, pending, 0, 0, NULL, 0) >= 0)) break;
+
+    if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY)) {
+      YieldThread();
+      continue;
+    }
+
+    // Any other error won't go away, if the kernel hasn't
+    // taken the entry it never will
+    if ((i32)(u->sqHead->load(std::memory_order_acquire) - (tail+1)) < 0) {
+      u->sqTail->store(tail, std::memory_order_release);
+      ret = false;
+    }
+    break;
+  }
+
+  UnlockLightMutex(&u->lock);
+  return ret;
+}
+
+// Reaper thread entry point
+static void ReaperMain(void*) {
+  uring_t *u = &s_uring;
+
+  for (;;) {
+    u32 head = u->cqHead->load(std::memory_order_relaxed);
+    const u32 tail = u->cqTail->load(std::memory_order_acquire);
+
+    if (head == tail) {
+      syscall(__NR_io_uring_enter, u->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+      continue;
+    }
+
+    bfast quit = false;
+    for (; head != tail; ++head) {
+      const io_uring_cqe * const cqe = u->cqes + (head&u->cqMask);
+
+      if (cqe->user_data)
+        CompleteRead((async_read_t*)(uptr)cqe->user_data, (cqe->res < 0) ? -1 : cqe->res);
+      else quit = true;
+    }
+
+    u->cqHead->store(head, std::memory_order_release);
+    if (quit) return;
+  }
+}
+
+bfast InitPlatformAsyncIO() {
+  uring_t *u = &s_uring;
+
+  // Room for every read in flight, and the reaper's quit entry
+  io_uring_params p;
+  memset(&p, 0, sizeof(p));
+
+  u->fd = syscall(__NR_io_uring_setup, ASYNC_READ_MAX*2, &p);
+  if (u->fd < 0) return false;
+
+  u->sqRing = u->cqRing = u->sqes = NULL;
+
+  // IORING_OP_READ came in Linux 5.6, fast poll in 5.7
+  if (!(p.features & IORING_FEAT_FAST_POLL)) {
+    CloseUring(u);
+    return false;
+  }
+
+  u->sqRingSize = p.sq_off.array + p.sq_entries*sizeof(u32);
+  u->cqRingSize = p.cq_off.cqes + p.cq_entries*sizeof(io_uring_cqe);
+  u->sqesSize = p.sq_entries*sizeof(io_uring_sqe);
+
+  // Both rings can be in one mapping
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cqRingSize > u->sqRingSize) u->sqRingSize = u->cqRingSize;
+    u->cqRingSize = u->sqRingSize;
+  }
+
+  u->sqRing = MapRing(u->fd, u->sqRingSize, IORING_OFF_SQ_RING);
+  if (u->sqRing) {
+    u->cqRing = (p.features & IORING_FEAT_SINGLE_MMAP) ? u->sqRing :
+      MapRing(u->fd, u->cqRingSize, IORING_OFF_CQ_RING);
+  }
+  if (u->cqRing) u->sqes = (io_uring_sqe*)MapRing(u->fd, u->sqesSize, IORING_OFF_SQES);
+
+  if (!u->sqes) {
+    CloseUring(u);
+    return false;
+  }
+
+  u->sqHead = RingPtr<std::atomic<u32>>(u->sqRing, p.sq_off.head);
+  u->sqTail = RingPtr<std::atomic<u32>>(u->sqRing, p.sq_off.tail);
+  u->sqMask = *RingPtr<u32>(u->sqRing, p.sq_off.ring_mask);
+  u->sqArray = RingPtr<u32>(u->sqRing, p.sq_off.array);
+
+  u->cqHead = RingPtr<std::atomic<u32>>(u->cqRing, p.cq_off.head);
+  u->cqTail = RingPtr<std::atomic<u32>>(u->cqRing, p.cq_off.tail);
+  u->cqMask = *RingPtr<u32>(u->cqRing, p.cq_off.ring_mask);
+  u->cqes = RingPtr<const io_uring_cqe>(u->cqRing, p.cq_off.cqes);
+
+  InitLightMutex(&u->lock);
+
+  thread_attr_t attr = {};
+  attr.name = "io_uring reaper";
+
+  if (!CreateThread(&u->reaper, ReaperMain, NULL, &attr)) {
+    CloseUring(u);
+    return false;
+  }
+
+  return true;
+}
+
+void FreePlatformAsyncIO() {
+  uring_t *u = &s_uring;
+
+  // If the reaper can't be told to quit, leave it and the
+  // ring to the OS
+  if (!PushUring(u, IORING_OP_NOP, -1, NULL, 0, 0, 0)) return;
+
+  WaitThread(&u->reaper);
+  DestroyThread(&u->reaper);
+
+  CloseUring(u);
+}
+
+bfast SubmitPlatformRead(async_read_t *r) {
+  file_stream_t * const data = (file_stream_t*)r->file;
+  return PushUring(&s_uring, IORING_OP_READ, data->fd, r->out, r->size, r->offset, (u64)(uptr)r);
+}
+
+#else //LOVEYLIB_IO_URING
+
+// No platform async IO, reads are done by IO threads
+bfast InitPlatformAsyncIO() {return false;}
+void FreePlatformAsyncIO() {}
+bfast SubmitPlatformRead(async_read_t*) {ASSERT(false); return false;}
+
+#endif //LOVEYLIB_IO_URING
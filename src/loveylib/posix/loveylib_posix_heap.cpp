@@ -37,8 +37,13 @@
 #include "loveylib/assert.h"
 
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+// Explicit huge page size, MAP_HUGETLB uses the default
+// huge page size, which is 2MB on anything we run on
+static constexpr const uptr HUGE_PAGE_SIZE = 2*1024*1024;
+
 // Private information stored at the start of the heap
 struct heap_info_t {
   // Heap length
@@ -56,7 +61,20 @@ uptr GetPageSize() {
   return sysconf(_SC_PAGESIZE);
 }
 
-heap_t InitHeap(uptr size) {
+// Fault in pages, keeping their contents
+static void PrefaultPages(u8 *p, uptr size) {
+#ifdef MADV_POPULATE_WRITE
+  if (!madvise(p, size, MADV_POPULATE_WRITE)) return;
+#endif
+
+  // Touch each page if the kernel can't do it for us
+  const uptr pageSize = GetPageSize();
+  for (volatile u8 *i = p; i < p+size; i += pageSize) *i = *i;
+}
+
+// Map heap, with heap info in the first page
+// The rest of the heap is mapped with prot
+static heap_t MapHeap(uptr size, int prot, heap_flags_t flags) {
   ASSERT(size);
 
   const uptr pageSize = GetPageSize();
@@ -73,12 +91,44 @@ heap_t InitHeap(uptr size) {
   // Use the first page of the heap to store specific information
   size += pageSize;
 
+  const int mapFlags = MAP_PRIVATE|MAP_ANONYMOUS;
+
+  heap_info_t *info = (heap_info_t*)MAP_FAILED;
+
+  // Try explicit huge pages first, they can't be partially
+  // committed so reserved heaps don't use them
+#ifdef MAP_HUGETLB
+  if ((flags & HEAP_HUGE_PAGES_BIT) && (prot != PROT_NONE)) {
+    const uptr hugeSize = AlignUpPow2(size, HUGE_PAGE_SIZE);
+    info = (heap_info_t*)mmap(NULL, hugeSize, prot, mapFlags|MAP_HUGETLB, -1, 0);
+    if (info != (heap_info_t*)MAP_FAILED) {
+      size = hugeSize;
+      flags &= ~HEAP_HUGE_PAGES_BIT;
+    }
+  }
+#endif
+
   // Allocate heap
-  heap_info_t *info = (heap_info_t*)mmap(NULL, size,
-                                     PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
-                                     -1, 0);
+  if (info == (heap_info_t*)MAP_FAILED)
+    info = (heap_info_t*)mmap(NULL, size, prot, mapFlags, -1, 0);
   if (info == (heap_info_t*)MAP_FAILED) return NULL;
 
+  // Make sure heap info can be written
+  if ((prot != (PROT_READ|PROT_WRITE)) &&
+      mprotect(info, pageSize, PROT_READ|PROT_WRITE))
+  {
+    munmap(info, size);
+    return NULL;
+  }
+
+  // Fall back to transparent huge pages
+#ifdef MADV_HUGEPAGE
+  if (flags & HEAP_HUGE_PAGES_BIT) madvise(info, size, MADV_HUGEPAGE);
+#endif
+
+  // Fault in pages after madvise, so they can be huge pages
+  if ((flags & HEAP_PREFAULT_BIT) && (prot != PROT_NONE)) PrefaultPages((u8*)info, size);
+
   // Setup heap info
   info->size = size;
 
@@ -86,6 +136,34 @@ heap_t InitHeap(uptr size) {
   return (u8*)info + pageSize;
 }
 
+heap_t InitHeap(uptr size, heap_flags_t flags) {
+  return MapHeap(size, PROT_READ|PROT_WRITE, flags);
+}
+
+heap_t ReserveHeap(uptr size, heap_flags_t flags) {
+  // Reserve address space, without any memory behind it
+  return MapHeap(size, PROT_NONE, flags);
+}
+
+bfast CommitHeap(heap_t heap, uptr offset, uptr size, heap_flags_t flags) {
+  ASSERT(heap);
+  ASSERT(!(offset & (GetPageSize()-1)));
+
+  // Pages are allocated as they're touched
+  if (mprotect((u8*)heap + offset, size, PROT_READ|PROT_WRITE)) return false;
+
+  if (flags & HEAP_PREFAULT_BIT) PrefaultPages((u8*)heap + offset, size);
+  return true;
+}
+
+void ResetHeap(heap_t heap, uptr offset, uptr size) {
+  ASSERT(heap);
+  ASSERT(!(offset & (GetPageSize()-1)));
+
+  // Anonymous pages read back as 0 after this
+  madvise((u8*)heap + offset, size, MADV_DONTNEED);
+}
+
 void DestroyHeap(heap_t heap) {
   ASSERT(heap);
 
@@ -95,3 +173,10 @@ void DestroyHeap(heap_t heap) {
   // Unmap heap, with heap size
   munmap(info, info->size);
 }
+
+uptr GetPageFaultCount() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) return 0;
+
+  return usage.ru_minflt + usage.ru_majflt;
+}
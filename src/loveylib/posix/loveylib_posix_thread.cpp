@@ -33,15 +33,22 @@
 
 // sem_timedwait/clock_gettime
 #define _POSIX_C_SOURCE 200112L
+// syscall, thread names and affinity
+// g++ always defines _GNU_SOURCE
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define _DARWIN_C_SOURCE
 
 #include "loveylib/types.h"
 #include "loveylib/thread.h"
+#include "loveylib/atomic.h"
 #include "loveylib_config.h"
 
 // If we don't have threads, make dummy wrappers
 #ifndef LOVEYLIB_THREADS
 
-bfast CreateThread(thread_t*, thread_entry_point_t, void*) {return false;}
+bfast CreateThread(thread_t*, thread_entry_point_t, void*, const thread_attr_t*) {return false;}
 bfast ThreadRunning(thread_t*) {return false;}
 bfast IsCallingThread(thread_t*) {return false;}
 bfast WaitThread(thread_t*) {return false;}
@@ -55,6 +62,10 @@ bfast CreateSema(semaphore_t*) {return false;}
 bfast WaitSema(semaphore_t*, u32) {return false;}
 bfast SignalSema(semaphore_t*) {return false;}
 void DestroySema(semaphore_t*) {}
+uptr GetProcessorCount() {return 1;}
+void YieldThread() {}
+void FutexWait(std::atomic<u32>*, u32) {}
+void FutexWake(std::atomic<u32>*, bfast) {}
 
 #else //LOVEYLIB_THREADS
 
@@ -62,7 +73,17 @@ void DestroySema(semaphore_t*) {}
 #include <semaphore.h>
 #include <time.h>
 #include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/resource.h>
 #include <atomic>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 // Thread state
 enum thread_state_e : ufast {
@@ -79,6 +100,11 @@ struct posix_thread_t {
   thread_entry_point_t entry;
 
   std::atomic<thread_state_t> state;
+
+  // Attributes the thread applies to itself
+  thread_priority_t priority;
+  u64 affinity;
+  char name[THREAD_NAME_LENGTH+1];
 };
 static_assert(sizeof(posix_thread_t) <= sizeof(thread_t), "");
 
@@ -92,10 +118,48 @@ struct posix_semaphore_t {
 };
 static_assert(sizeof(posix_semaphore_t) <= sizeof(semaphore_t), "");
 
+// Apply thread attributes to the calling thread
+// Attributes that can't be applied are ignored
+static void ApplyThreadAttr(posix_thread_t *t) {
+#if defined(__linux__)
+  if (t->name[0]) pthread_setname_np(pthread_self(), t->name);
+
+  if (t->affinity) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (uptr i = 0; i < 64; ++i)
+      if (t->affinity&((u64)1<<i)) CPU_SET(i, &set);
+
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#elif defined(__APPLE__)
+  // Apple threads can only name themselves, and have no affinity
+  if (t->name[0]) pthread_setname_np(t->name);
+#endif
+
+  if (t->priority == THREAD_PRIO_REALTIME) {
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO)+10;
+    if (param.sched_priority > sched_get_priority_max(SCHED_FIFO))
+      param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+
+    if (!pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) return;
+  }
+
+#ifdef __linux__
+  // Linux threads have their own nice value, lowering it
+  // needs permission, so it might not work either
+  if (t->priority != THREAD_PRIO_NORMAL)
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), -10);
+#endif
+}
+
 // POSIX thread entry point wrapper
 static void *EntryPoint(void *thread) {
   posix_thread_t *t = (posix_thread_t*)thread;
 
+  ApplyThreadAttr(t);
+
   // Run actual entry point
   t->entry(t->data);
 
@@ -106,13 +170,42 @@ static void *EntryPoint(void *thread) {
   pthread_exit(NULL);
 }
 
-bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data) {
+bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data,
+                   const thread_attr_t *attr)
+{
   posix_thread_t *t = (posix_thread_t*)out;
 
   t->entry = entry;
   t->data = data;
   t->state.store(THREAD_RUNNING, std::memory_order_relaxed);
-  const int ret = pthread_create(&t->tid, NULL, EntryPoint, t);
+
+  t->priority = THREAD_PRIO_NORMAL;
+  t->affinity = 0;
+  t->name[0] = 0;
+
+  pthread_attr_t pattr;
+  if (pthread_attr_init(&pattr) != 0) return false;
+
+  if (attr) {
+    t->priority = attr->priority;
+    t->affinity = attr->affinity;
+    if (attr->name) {
+      strncpy(t->name, attr->name, THREAD_NAME_LENGTH);
+      t->name[THREAD_NAME_LENGTH] = 0;
+    }
+
+    if (attr->stackSize) {
+      // Stacks must be a whole number of pages
+      const uptr page = sysconf(_SC_PAGESIZE);
+      uptr size = (attr->stackSize+page-1)/page*page;
+      if (size < (uptr)PTHREAD_STACK_MIN) size = PTHREAD_STACK_MIN;
+
+      pthread_attr_setstacksize(&pattr, size);
+    }
+  }
+
+  const int ret = pthread_create(&t->tid, &pattr, EntryPoint, t);
+  pthread_attr_destroy(&pattr);
   if (ret != 0) {
     return false;
   }
@@ -232,4 +325,37 @@ void DestroySema(semaphore_t *sema) {
   sem_destroy(&s->s);
 }
 
+uptr GetProcessorCount() {
+  const long ret = sysconf(_SC_NPROCESSORS_ONLN);
+  if (ret < 1) return 1;
+
+  return ret;
+}
+
+void YieldThread() {
+  sched_yield();
+}
+
+#ifdef __linux__
+
+void FutexWait(std::atomic<u32> *addr, u32 expected) {
+  static_assert(sizeof(std::atomic<u32>) == sizeof(u32), "");
+  syscall(SYS_futex, (u32*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void FutexWake(std::atomic<u32> *addr, bfast all) {
+  syscall(SYS_futex, (u32*)addr, FUTEX_WAKE_PRIVATE, all ? 0x7fffffff : 1, NULL, NULL, 0);
+}
+
+#else //__linux__
+
+// No futexes, let parked threads spin
+void FutexWait(std::atomic<u32> *addr, u32 expected) {
+  if (addr->load(std::memory_order_relaxed) == expected) sched_yield();
+}
+
+void FutexWake(std::atomic<u32>*, bfast) {}
+
+#endif //__linux__
+
 #endif //LOVEYLIB_THREADS
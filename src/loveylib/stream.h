@@ -114,4 +114,48 @@ bfast GetStandardInput(stream_t *out);
 // Same but standard output
 bfast GetStandardOutput(stream_t *out);
 
+///////////////////////
+// Buffered streams
+//
+// A buffered stream wraps another stream, reading ahead of
+// and holding back writes to it, a buffer's worth at a time.
+// Reads and writes at least a buffer long skip the buffer.
+
+// Buffered stream state
+// Must outlive the buffered stream using it
+struct stream_buffer_t {
+  // Underlying stream, must stay open while buffered
+  stream_t *base;
+
+  u8 *buf;
+  uptr size;
+
+  // While reading, [pos, end) is read ahead data
+  // While writing, [0, pos) is held back data, and end is 0
+  uptr pos, end;
+};
+
+// Open buffered stream over base, buffering size bytes in buf
+void OpenBufferedStream(stream_t *out, stream_buffer_t *b, stream_t *base,
+                        void *buf, uptr size);
+
+// Write data held back by buffered stream to it's underlying stream
+// Returns false on error
+bfast FlushBufferedStream(stream_t *s);
+
+// Flush and close buffered stream
+// The underlying stream stays open
+void CloseBufferedStream(stream_t *s);
+
+///////////////////////
+// Memory streams
+//
+// A memory stream reads from a block of memory, like a
+// mapped file. It can't be written to, and doesn't need
+// to be closed.
+
+// Open memory stream over size bytes at data
+// data must outlive the stream
+void OpenMemoryStream(stream_t *out, const void *data, uptr size);
+
 #endif //_LOVEYLIB_STREAM_H
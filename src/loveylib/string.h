@@ -50,7 +50,9 @@ char *IntegerToString(char *out, i64 num, uptr len); // Left padded with 0's
 // if string is invalid
 i64 StringToInteger(const char *str);
 
-// Convert float to string
+// Convert float to string, with 6 decimal places
+// Infinities are written as inf, NaNs as nan
+// Writes at most 48 characters, counting the terminator
 // Returns pointer to end of number
 char *FloatToString(char *out, f32 num);
 
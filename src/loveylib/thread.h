@@ -76,11 +76,48 @@ struct alignas(16) semaphore_t {
 // returns
 typedef void (*thread_entry_point_t)(void */*data*/);
 
+// Thread scheduling priority
+enum thread_priority_e : ufast {
+  THREAD_PRIO_NORMAL = 0,
+
+  // Scheduled ahead of normal threads
+  THREAD_PRIO_HIGH,
+
+  // Real-time scheduling, for threads that can't miss
+  // deadlines, falls back to THREAD_PRIO_HIGH if the
+  // program isn't allowed to use it
+  THREAD_PRIO_REALTIME
+};
+typedef ufast thread_priority_t;
+
+// Longest thread name, not counting the null terminator
+static constexpr const uptr THREAD_NAME_LENGTH = 15;
+
+// Optional thread attributes
+// Every attribute is a hint, a thread is still created
+// if the platform can't apply it
+struct thread_attr_t {
+  thread_priority_t priority;
+
+  // Bit N set = thread can run on processor N
+  // If 0, the thread can run on any processor
+  u64 affinity;
+
+  // Stack size in bytes, 0 for the default
+  uptr stackSize;
+
+  // Thread name shown by debuggers, NULL for none
+  // Truncated to THREAD_NAME_LENGTH characters
+  const char *name;
+};
+
 // Create new thread
 // out must be an uninitialized thread
 // data is passed through to entry point
+// If attr is NULL, the thread gets default attributes
 // Returns false on failure
-bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data);
+bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data,
+                   const thread_attr_t *attr = NULL);
 
 // Check if a thread is running
 // Returns true if the thread is running, false if it isn't
@@ -138,4 +175,11 @@ bfast SignalSema(semaphore_t *sema);
 // MAKE SURE NO THREADS ARE WAITING ON THIS SEMA
 void DestroySema(semaphore_t *sema);
 
+// Get number of processors available to the program
+// Returns 1 if it's unknown, or threads aren't available
+uptr GetProcessorCount();
+
+// Give up the rest of the calling thread's time slice
+void YieldThread();
+
 #endif //_LOVEYLIB_THREAD_H
@@ -37,6 +37,11 @@
 #define _LOVEYLIB_UTILS_H
 
 #include "loveylib/types.h"
+#include "loveylib_config.h"
+
+#ifdef LOVEYLIB_MSVC
+#include <intrin.h> // _BitScan*
+#endif
 
 // Code that's only emitted in the debug
 // and release builds
@@ -103,4 +108,48 @@ static constexpr T CeilDiv(T a, T2 b) {
   return (a+(b-1))/b;
 }
 
+// Get index of highest set bit in v, v must not be 0
+static inline ufast HighBit(u64 v) {
+#if defined(LOVEYLIB_GNU)
+  return 63 - __builtin_clzll(v);
+#elif defined(LOVEYLIB_MSVC)
+  unsigned long ret;
+  if (v>>32) {
+    _BitScanReverse(&ret, (u32)(v>>32));
+    return ret+32;
+  }
+
+  _BitScanReverse(&ret, (u32)v);
+  return ret;
+#else
+  ufast ret = 0;
+  for (ufast i = 32; i; i >>= 1) {
+    if (v >> i) {
+      v >>= i;
+      ret += i;
+    }
+  }
+
+  return ret;
+#endif
+}
+
+// Get index of lowest set bit in v, v must not be 0
+static inline ufast LowBit(u64 v) {
+#if defined(LOVEYLIB_GNU)
+  return __builtin_ctzll(v);
+#elif defined(LOVEYLIB_MSVC)
+  unsigned long ret;
+  if (!(u32)v) {
+    _BitScanForward(&ret, (u32)(v>>32));
+    return ret+32;
+  }
+
+  _BitScanForward(&ret, (u32)v);
+  return ret;
+#else
+  return HighBit(v & (~v+1));
+#endif
+}
+
 #endif //_LOVEYLIB_UTILS_H
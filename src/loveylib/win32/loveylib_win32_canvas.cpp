@@ -42,6 +42,8 @@
 #include "log.h"
 #include "game.h"
 
+#include <atomic>
+
 // Class name
 static const char S_ClassName[] = "LoveyLib_Win32_Class_Name";
 
@@ -60,6 +62,13 @@ struct win32_canvas_data_t {
   key_code_t pressCode;
 
   bfast open; // Open status of window
+
+  // FANGAME HACK, DON'T MERGE INTO LOVEYLIB
+  // Window size to resize OpenGL viewport to on next render,
+  // (width<<16)|height, or 0 if it hasn't changed
+  // The context may be current on another thread, so it's
+  // resized by whoever renders
+  std::atomic<u32> resize;
 };
 
 // Get key code from virtual key
@@ -218,38 +227,9 @@ static win32::lresult_t WinProc(win32::hwnd_t win, u32 msg, win32::wparam_t wp,
   case win32::WM_SIZE:
     c = (win32_canvas_data_t*)win32::GetWindowLongPtr(win, win32::GWLP_USERDATA);
 
-    // Set viewport if we're in OpenGL
+    // Resize viewport on next render if we're in OpenGL
     if ((c->pub.base.api == CANVAS_OPENGL_API) && c->pub.gl.f.res) {
-      const int winWidth = T_LOWORD(lp);
-      const int winHeight = T_HIWORD(lp);
-      int x, y, width, height;
-      width = winWidth;
-      height = winHeight;
-
-      f32 color[4];
-      c->pub.gl.f.GetFloatv(gl::COLOR_CLEAR_VALUE, color);
-
-      c->pub.gl.f.Scissor(0, 0, width, height);
-      c->pub.gl.f.DrawBuffer(gl::FRONT_AND_BACK);
-      c->pub.gl.f.ClearColor(0, 0, 0, 0);
-      c->pub.gl.f.Clear(gl::COLOR_BUFFER_BIT);
-      c->pub.gl.f.DrawBuffer(gl::BACK);
-      c->pub.gl.f.ClearColor(color[0], color[1], color[2], color[3]);
-
-      const f32 ratio = (f32)width/(f32)height;
-      constexpr f32 GAME_RATIO = (f32)GAME_WIDTH/(f32)GAME_HEIGHT;
-      if (ratio >= GAME_RATIO) {
-        width = (f32)height*GAME_RATIO;
-        x = (winWidth-width)/2;
-        y = 0;
-      } else {
-        height = (f32)width/GAME_RATIO;
-        x = 0;
-        y = (winHeight-height)/2;
-      }
-
-      c->pub.gl.f.Viewport(x, y, width, height);
-      c->pub.gl.f.Scissor(x, y, width, height);
+      c->resize = ((u32)T_LOWORD(lp)<<16)|(u32)T_HIWORD(lp);
     }
     break;
 
@@ -548,6 +528,7 @@ bfast CreateSoftwareCanvas(canvas_t *out, const char *title, u32 width, u32 heig
   c->g.win = c->g.dev = NULL;
   c->g.evtFilled = false;
   c->g.pressCode = KEYC_NONE;
+  c->g.resize = 0;
   c->g.pub.software.surface = NULL;
   c->bmp = c->bmpDev = NULL;
 
@@ -613,11 +594,46 @@ struct win32_gl_canvas_data_t {
   win32::hglrc_t ctx;
 };
 
+// FANGAME HACK, DON'T MERGE INTO LOVEYLIB
+// Resize OpenGL viewport to fit game in window
+static void ResizeOpenGLViewport(gl::funcs_t *f, int winWidth, int winHeight) {
+  int x, y, width = winWidth, height = winHeight;
+
+  f32 color[4];
+  f->GetFloatv(gl::COLOR_CLEAR_VALUE, color);
+
+  f->Scissor(0, 0, width, height);
+  f->DrawBuffer(gl::FRONT_AND_BACK);
+  f->ClearColor(0, 0, 0, 0);
+  f->Clear(gl::COLOR_BUFFER_BIT);
+  f->DrawBuffer(gl::BACK);
+  f->ClearColor(color[0], color[1], color[2], color[3]);
+
+  const f32 ratio = (f32)width/(f32)height;
+  constexpr f32 GAME_RATIO = (f32)GAME_WIDTH/(f32)GAME_HEIGHT;
+  if (ratio >= GAME_RATIO) {
+    width = (f32)height*GAME_RATIO;
+    x = (winWidth-width)/2;
+    y = 0;
+  } else {
+    height = (f32)width/GAME_RATIO;
+    x = 0;
+    y = (winHeight-height)/2;
+  }
+
+  f->Viewport(x, y, width, height);
+  f->Scissor(x, y, width, height);
+}
+
 // Render OpenGL canvas
 static void RenderOpenGLCanvas(canvas_t *data) {
   win32_gl_canvas_data_t *c = (win32_gl_canvas_data_t*)data;
 
   win32::SwapBuffers(c->g.dev);
+
+  // Resize viewport for next frame, if the window was resized
+  const u32 size = c->g.resize.exchange(0);
+  if (size) ResizeOpenGLViewport(&c->g.pub.gl.f, size>>16, size&0xffff);
 }
 
 // Close OpenGL canvas
@@ -647,6 +663,14 @@ static const canvas_funcs_t S_OpenGLCanvasFuncs = {
   PollWin32CanvasEvent, RenderOpenGLCanvas, CloseOpenGLCanvas
 };
 
+// Bind or release OpenGL canvas' context
+bfast BindOpenGLCanvas(canvas_t *data, bfast bind) {
+  win32_gl_canvas_data_t *c = (win32_gl_canvas_data_t*)data;
+
+  if (bind) return win32::wglMakeCurrent(c->g.dev, c->ctx);
+  return win32::wglMakeCurrent(NULL, NULL);
+}
+
 // Create OpenGL canvas
 bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height) {
   out->c.base.f = &S_OpenGLCanvasFuncs;
@@ -658,6 +682,7 @@ bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height
   c->g.win = c->g.dev = NULL;
   c->g.evtFilled = false;
   c->g.pressCode = KEYC_NONE;
+  c->g.resize = 0;
   c->ctx = NULL;
   c->g.pub.gl.f.res = NULL;
 
@@ -769,4 +794,9 @@ bfast CreateOpenGLContext(canvas_t *out, const char *title, u32 width, u32 heigh
   return false;
 }
 
+bfast BindOpenGLCanvas(canvas_t *c, bfast bind) {
+  (void)c, (void)bind;
+  return false;
+}
+
 #endif //LOVEYLIB_OPENGL
@@ -35,6 +35,7 @@
 #include "loveylib/stream.h"
 #include "loveylib/file.h"
 #include "loveylib/assert.h"
+#include "loveylib/heap.h"
 
 #include "loveylib/win32/loveylib_windows.h"
 
@@ -152,3 +153,101 @@ void CloseFile(stream_t *f) {
   // Mark stream as closed
   i->f = NULL;
 }
+
+// Read whole file into a heap, for files that can't be mapped
+// Returns false on error
+static bfast ReadWholeFile(mapped_file_t *out, win32::handle_t handle, uptr size) {
+  u8 * const data = (u8*)InitHeap(size);
+  if (!data) return false;
+
+  for (uptr done = 0; done < size;) {
+    u32 ret;
+    if (!win32::ReadFile(handle, data+done, size-done, &ret, NULL) || !ret) {
+      DestroyHeap(data);
+      return false;
+    }
+
+    done += ret;
+  }
+
+  out->data = data;
+  out->size = size;
+  out->mapped = false;
+
+  return true;
+}
+
+// Map file handle, the handle can be closed after
+// Returns false on error
+static bfast MapHandle(mapped_file_t *out, win32::handle_t handle) {
+  u64 size;
+  if (!win32::GetFileSizeEx(handle, &size) || (size > (uptr)-1)) return false;
+
+  out->data = NULL;
+  out->size = size;
+  out->mapped = false;
+
+  // Empty files can't be mapped, and don't need to be
+  if (!size) return true;
+
+  const win32::handle_t mapping =
+    win32::CreateFileMapping(handle, NULL, win32::PAGE_READONLY, 0, 0, NULL);
+
+  if (mapping) {
+    out->data = (const u8*)win32::MapViewOfFile(mapping, win32::FILE_MAP_READ, 0, 0, 0);
+    out->mapped = out->data != NULL;
+
+    // The view stays valid without the mapping
+    win32::CloseHandle(mapping);
+  }
+
+  return out->mapped || ReadWholeFile(out, handle, size);
+}
+
+bfast MapFile(mapped_file_t *out, const char *name) {
+  const win32::handle_t handle =
+    win32::CreateFile(name, win32::GENERIC_READ, win32::FILE_SHARE_READ, NULL,
+                      win32::OPEN_EXISTING, win32::FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == win32::INVALID_HANDLE_VALUE) return false;
+
+  const bfast ret = MapHandle(out, handle);
+
+  win32::CloseHandle(handle);
+  return ret;
+}
+
+bfast MapFile(mapped_file_t *out, stream_t *f) {
+  file_stream_t * const data = (file_stream_t*)f;
+  ASSERT(data->f == &S_FileFuncs);
+
+  return MapHandle(out, data->handle);
+}
+
+void UnmapFile(mapped_file_t *file) {
+  if (file->mapped) win32::UnmapViewOfFile(file->data);
+  else if (file->data) DestroyHeap((heap_t)file->data);
+
+  file->data = NULL;
+  file->size = 0;
+  file->mapped = false;
+}
+
+iptr ReadFileAt(stream_t *f, void *out, uptr size, u64 offset) {
+  file_stream_t * const data = (file_stream_t*)f;
+  ASSERT(f->open());
+
+  // Synchronous handles read at the overlapped offset
+  win32::overlapped_t o = {};
+  o.offset = (u32)offset;
+  o.offsetHigh = (u32)(offset>>32);
+
+  u32 ret;
+  const b32 status = win32::ReadFile(data->handle, out, size, &ret, &o);
+
+  return status ? ret : -1;
+}
+
+// No platform async IO, reads are done by IO threads
+bfast InitPlatformAsyncIO() {return false;}
+void FreePlatformAsyncIO() {}
+bfast SubmitPlatformRead(async_read_t*) {ASSERT(false); return false;}
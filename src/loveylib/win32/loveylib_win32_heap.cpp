@@ -38,6 +38,12 @@
 
 #include "loveylib/win32/loveylib_windows.h"
 
+// Fault in pages, keeping their contents
+static void PrefaultPages(u8 *p, uptr size) {
+  const uptr pageSize = GetPageSize();
+  for (volatile u8 *i = p; i < p+size; i += pageSize) *i = *i;
+}
+
 uptr GetPageSize() {
   win32::system_info_t info;
   win32::GetSystemInfo(&info);
@@ -45,7 +51,9 @@ uptr GetPageSize() {
   return info.pageSize;
 }
 
-heap_t InitHeap(uptr size) {
+// Huge pages need the lock pages privilege on windows,
+// so HEAP_HUGE_PAGES_BIT is ignored
+heap_t InitHeap(uptr size, heap_flags_t flags) {
   ASSERT(size);
 
   const uptr pageSize = GetPageSize();
@@ -61,13 +69,58 @@ heap_t InitHeap(uptr size) {
                                    win32::MEM_RESERVE|win32::MEM_COMMIT,
                                    win32::PAGE_READWRITE);
 
+  if (ret && (flags & HEAP_PREFAULT_BIT)) PrefaultPages((u8*)ret, size);
+
   // Return heap, NULL if allocation failed
   return ret;
 }
 
+heap_t ReserveHeap(uptr size, heap_flags_t flags) {
+  (void)flags;
+
+  ASSERT(size);
+
+  const uptr pageSize = GetPageSize();
+
+  // Fail if the page size isn't a power of 2
+  if ((pageSize-1) & pageSize) return NULL;
+
+  // Align size up to the page size
+  size = AlignUpPow2(size, pageSize);
+
+  // Reserve heap, without committing anything
+  return win32::VirtualAlloc(NULL, size, win32::MEM_RESERVE, win32::PAGE_NOACCESS);
+}
+
+bfast CommitHeap(heap_t heap, uptr offset, uptr size, heap_flags_t flags) {
+  ASSERT(heap);
+  ASSERT(!(offset & (GetPageSize()-1)));
+
+  if (!win32::VirtualAlloc((u8*)heap + offset, size,
+                           win32::MEM_COMMIT, win32::PAGE_READWRITE))
+  {
+    return false;
+  }
+
+  if (flags & HEAP_PREFAULT_BIT) PrefaultPages((u8*)heap + offset, size);
+  return true;
+}
+
+void ResetHeap(heap_t heap, uptr offset, uptr size) {
+  ASSERT(heap);
+  ASSERT(!(offset & (GetPageSize()-1)));
+
+  // Pages stay committed, but don't have to be kept in memory
+  win32::VirtualAlloc((u8*)heap + offset, size, win32::MEM_RESET, win32::PAGE_READWRITE);
+}
+
 void DestroyHeap(heap_t heap) {
   ASSERT(heap);
 
   // Free heap
   win32::VirtualFree(heap, 0, win32::MEM_RELEASE);
 }
+
+uptr GetPageFaultCount() {
+  return win32::GetPageFaultCount();
+}
@@ -33,6 +33,7 @@
 
 #include "loveylib/types.h"
 #include "loveylib/thread.h"
+#include "loveylib/atomic.h"
 #include "loveylib/assert.h"
 #include "loveylib/utils.h"
 #include "loveylib_config.h"
@@ -40,7 +41,7 @@
 // If we don't have threads, make dummy wrappers
 #ifndef LOVEYLIB_THREADS
 
-bfast CreateThread(thread_t*, thread_entry_point_t, void*) {return false;}
+bfast CreateThread(thread_t*, thread_entry_point_t, void*, const thread_attr_t*) {return false;}
 bfast ThreadRunning(thread_t*) {return false;}
 bfast IsCallingThread(thread_t*) {return false;}
 bfast WaitThread(thread_t*) {return false;}
@@ -54,6 +55,10 @@ bfast CreateSema(semaphore_t*) {return false;}
 bfast WaitSema(semaphore_t*, u32) {return false;}
 bfast SignalSema(semaphore_t*) {return false;}
 void DestroySema(semaphore_t*) {}
+uptr GetProcessorCount() {return 1;}
+void YieldThread() {}
+void FutexWait(std::atomic<u32>*, u32) {}
+void FutexWake(std::atomic<u32>*, bfast) {}
 
 #else //LOVEYLIB_THREADS
 
@@ -89,16 +94,62 @@ static u32 WIN32_WINAPI EntryPoint(void *param) {
   return 0;
 }
 
-bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data) {
+// SetThreadDescription, only on Windows 10 and later
+typedef i32 (WIN32_WINAPI *set_thread_description_t)(win32::handle_t /*thread*/,
+                                                     const wchar_t */*desc*/);
+
+// Name thread, if this version of Windows can
+static void SetThreadName(win32::handle_t thread, const char *name) {
+  static set_thread_description_t setDesc = (set_thread_description_t)
+    win32::GetProcAddress(win32::GetModuleHandle("kernel32.dll"), "SetThreadDescription");
+  if (!setDesc) return;
+
+  wchar_t wideName[THREAD_NAME_LENGTH+1];
+  uptr i;
+  for (i = 0; name[i] && (i < THREAD_NAME_LENGTH); ++i) wideName[i] = (u8)name[i];
+  wideName[i] = 0;
+
+  setDesc(thread, wideName);
+}
+
+bfast CreateThread(thread_t *out, thread_entry_point_t entry, void *data,
+                   const thread_attr_t *attr)
+{
   win32_thread_t *t = (win32_thread_t*)out;
 
   t->entry = entry;
   t->data = data;
-  t->handle = win32::CreateThread(NULL, 0, EntryPoint, t, 0, NULL);
+
+  if (!attr) {
+    t->handle = win32::CreateThread(NULL, 0, EntryPoint, t, 0, NULL);
+    if (!t->handle) return false;
+
+    IN_DEBUG(t->magic = THREAD_MAGIC);
+    return true;
+  }
+
+  // Apply attributes before the thread starts running
+  u32 flags = win32::CREATE_SUSPENDED;
+  if (attr->stackSize) flags |= win32::STACK_SIZE_PARAM_IS_A_RESERVATION;
+
+  t->handle = win32::CreateThread(NULL, attr->stackSize, EntryPoint, t, flags, NULL);
   if (!t->handle) return false;
 
   IN_DEBUG(t->magic = THREAD_MAGIC);
 
+  switch (attr->priority) {
+  case THREAD_PRIO_HIGH:
+    win32::SetThreadPriority(t->handle, win32::THREAD_PRIORITY_HIGHEST);
+    break;
+  case THREAD_PRIO_REALTIME:
+    win32::SetThreadPriority(t->handle, win32::THREAD_PRIORITY_TIME_CRITICAL);
+    break;
+  }
+
+  if (attr->affinity) win32::SetThreadAffinityMask(t->handle, (uptr)attr->affinity);
+  if (attr->name) SetThreadName(t->handle, attr->name);
+
+  win32::ResumeThread(t->handle);
   return true;
 }
 
@@ -194,4 +245,26 @@ void DestroySema(semaphore_t *sema) {
   win32::CloseHandle(s->handle);
 }
 
+uptr GetProcessorCount() {
+  win32::system_info_t info;
+  win32::GetSystemInfo(&info);
+
+  if (!info.processorCount) return 1;
+  return info.processorCount;
+}
+
+void YieldThread() {
+  win32::SwitchToThread();
+}
+
+void FutexWait(std::atomic<u32> *addr, u32 expected) {
+  static_assert(sizeof(std::atomic<u32>) == sizeof(u32), "");
+  win32::WaitOnAddress(addr, &expected, sizeof(u32), win32::INFINITE);
+}
+
+void FutexWake(std::atomic<u32> *addr, bfast all) {
+  if (all) win32::WakeByAddressAll(addr);
+  else win32::WakeByAddressSingle(addr);
+}
+
 #endif //LOVEYLIB_THREADS
@@ -35,10 +35,12 @@
 // INCLUDE THIS BEFORE WINDOWS.H
 #include "loveylib/win32/loveylib_windows.h"
 #include <windows.h>
+#include <psapi.h>
 
 #undef ReadConsole
 #undef WriteConsole
 #undef CreateFile
+#undef CreateFileMapping
 #undef SetWindowLongPtr
 #undef GetWindowLongPtr
 #undef SetClassLongPtr
@@ -89,6 +91,14 @@ b32 win32::VirtualFree(void *addr, u32 size, u32 type) {
   return ::VirtualFree(addr, size, type);
 }
 
+u32 win32::GetPageFaultCount() {
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!::K32GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+
+  return counters.PageFaultCount;
+}
+
 b32 win32::ReadConsole(win32::handle_t input, void *buf, u32 size, u32 *read, void *inputControl) {
   return ::ReadConsoleA((HANDLE)input, buf, size, (LPDWORD)read, (PCONSOLE_READCONSOLE_CONTROL)inputControl);
 }
@@ -124,6 +134,25 @@ b32 win32::CloseHandle(win32::handle_t handle) {
   return ::CloseHandle((HANDLE)handle);
 }
 
+b32 win32::GetFileSizeEx(win32::handle_t file, u64 *size) {
+  return ::GetFileSizeEx((HANDLE)file, (LARGE_INTEGER*)size);
+}
+
+win32::handle_t win32::CreateFileMapping(win32::handle_t file, void *securityAttr, u32 protect,
+                                         u32 maxSizeHigh, u32 maxSizeLow, const char *name)
+{
+  return (win32::handle_t)::CreateFileMappingA((HANDLE)file, (LPSECURITY_ATTRIBUTES)securityAttr,
+                                               protect, maxSizeHigh, maxSizeLow, name);
+}
+
+void *win32::MapViewOfFile(win32::handle_t mapping, u32 desiredAccess, u32 offsetHigh, u32 offsetLow, uptr size) {
+  return ::MapViewOfFile((HANDLE)mapping, desiredAccess, offsetHigh, offsetLow, size);
+}
+
+b32 win32::UnmapViewOfFile(const void *addr) {
+  return ::UnmapViewOfFile(addr);
+}
+
 iptr win32::SetWindowLongPtr(win32::hwnd_t win, int index, iptr newLong) {
   return ::SetWindowLongPtrA((HWND)win, index, newLong);
 }
@@ -304,6 +333,34 @@ u32 win32::GetCurrentThreadId() {
   return ::GetCurrentThreadId();
 }
 
+b32 win32::SwitchToThread() {
+  return ::SwitchToThread();
+}
+
+b32 win32::SetThreadPriority(win32::handle_t thread, int priority) {
+  return ::SetThreadPriority((HANDLE)thread, priority);
+}
+
+uptr win32::SetThreadAffinityMask(win32::handle_t thread, uptr mask) {
+  return ::SetThreadAffinityMask((HANDLE)thread, mask);
+}
+
+u32 win32::ResumeThread(win32::handle_t thread) {
+  return ::ResumeThread((HANDLE)thread);
+}
+
+b32 win32::WaitOnAddress(volatile void *addr, void *compare, uptr size, u32 milliseconds) {
+  return ::WaitOnAddress(addr, compare, size, milliseconds);
+}
+
+void win32::WakeByAddressSingle(void *addr) {
+  ::WakeByAddressSingle(addr);
+}
+
+void win32::WakeByAddressAll(void *addr) {
+  ::WakeByAddressAll(addr);
+}
+
 u32 win32::GetThreadId(win32::handle_t thread) {
   return ::GetThreadId((HANDLE)thread);
 }
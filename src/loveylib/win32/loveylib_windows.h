@@ -93,13 +93,20 @@ namespace win32 {
   static constexpr const u32 GENERIC_READ = 0x80000000;
   static constexpr const u32 GENERIC_WRITE = 0x40000000;
 
+  static constexpr const u32 FILE_SHARE_READ = 0x1;
+
+  static constexpr const u32 PAGE_READONLY = 0x02;
+  static constexpr const u32 FILE_MAP_READ = 0x4;
+
   static constexpr const u32 FILE_ATTRIBUTE_NORMAL = 0x80;
   static constexpr const handle_t INVALID_HANDLE_VALUE = -(handle_t)1;
 
   static constexpr const u32 MEM_COMMIT = 0x00001000;
   static constexpr const u32 MEM_RESERVE = 0x00002000;
   static constexpr const u32 MEM_RELEASE = 0x00008000;
+  static constexpr const u32 MEM_RESET = 0x00080000;
 
+  static constexpr const u32 PAGE_NOACCESS = 0x01;
   static constexpr const u32 PAGE_READWRITE = 0x04;
 
   static constexpr const u32 VK_BACK = 0x08;
@@ -259,6 +266,12 @@ namespace win32 {
 
   static constexpr const u32 STILL_ACTIVE = 0x103;
 
+  static constexpr const u32 CREATE_SUSPENDED = 0x4;
+  static constexpr const u32 STACK_SIZE_PARAM_IS_A_RESERVATION = 0x10000;
+
+  static constexpr const int THREAD_PRIORITY_HIGHEST = 2;
+  static constexpr const int THREAD_PRIORITY_TIME_CRITICAL = 15;
+
   static constexpr const u32 INFINITE = 0xffffffff;
 
   static constexpr const u32 WAIT_FAILED = 0xffffffff;
@@ -387,6 +400,14 @@ namespace win32 {
     u32 dwFlags;
   };
 
+  struct overlapped_t {
+    uptr internal;
+    uptr internalHigh;
+    u32 offset;
+    u32 offsetHigh;
+    handle_t event;
+  };
+
   // Macros (defined as inline/constexpr functions where possible)
   static constexpr char *MakeIntResource(u16 id) {
     return (char*)(uptr)id;
@@ -400,6 +421,7 @@ namespace win32 {
   void GetSystemInfo(system_info_t *out);
   void *VirtualAlloc(void *addr, uptr size, u32 type, u32 protect);
   b32 VirtualFree(void *addr, u32 size, u32 type);
+  u32 GetPageFaultCount(); // GetProcessMemoryInfo(GetCurrentProcess()).PageFaultCount
   b32 ReadConsole(handle_t input, void *buf, u32 size, u32 *read, void *inputControl);
   b32 WriteConsole(handle_t output, const void *buf, u32 size, u32 *written, void *reserved);
   handle_t GetStdHandle(u32 handle);
@@ -409,6 +431,11 @@ namespace win32 {
   handle_t CreateFile(const char *filename, u32 desiredAccess, u32 shareMode, void *securityAttr,
                       u32 creationDisposition, u32 flags, handle_t templateFile);
   b32 CloseHandle(handle_t handle);
+  b32 GetFileSizeEx(handle_t file, u64 *size);
+  handle_t CreateFileMapping(handle_t file, void *securityAttr, u32 protect,
+                             u32 maxSizeHigh, u32 maxSizeLow, const char *name);
+  void *MapViewOfFile(handle_t mapping, u32 desiredAccess, u32 offsetHigh, u32 offsetLow, uptr size);
+  b32 UnmapViewOfFile(const void *addr);
   iptr SetWindowLongPtr(hwnd_t win, int index, iptr newLong);
   iptr GetWindowLongPtr(hwnd_t win, int index);
   void PostQuitMessage(int exitCode);
@@ -456,6 +483,13 @@ namespace win32 {
                         u32 creationFlags, u32 *threadId);
   b32 GetExitCodeThread(handle_t thread, u32 *exitCode);
   u32 GetCurrentThreadId();
+  b32 SwitchToThread();
+  b32 SetThreadPriority(handle_t thread, int priority);
+  uptr SetThreadAffinityMask(handle_t thread, uptr mask);
+  u32 ResumeThread(handle_t thread);
+  b32 WaitOnAddress(volatile void *addr, void *compare, uptr size, u32 milliseconds);
+  void WakeByAddressSingle(void *addr);
+  void WakeByAddressAll(void *addr);
   u32 GetThreadId(handle_t thread);
   u32 WaitForSingleObject(handle_t handle, u32 milliseconds);
   handle_t CreateMutex(void *mutexAttr, b32 initialOwner, const char *name);
@@ -42,6 +42,8 @@
 #include "log.h"
 #include "str.h"
 
+#include <atomic>
+
 // Xlib headers
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -88,6 +90,13 @@ struct xlib_canvas_data_t {
 
   // True if the window is currently mapped
   bfast winMapped;
+
+  // FANGAME HACK, DON'T IMPORT INTO LOVEYLIB!
+  // Window size to resize OpenGL viewport to on next render,
+  // (width<<16)|height, or 0 if it hasn't changed
+  // The context may be current on another thread, so it's
+  // resized by whoever renders
+  std::atomic<u32> resize;
 };
 
 // Returns class data size
@@ -323,34 +332,7 @@ static bfast PollXlibCanvasEvent(canvas_t *data, event_t *out) {
       // FANGAME HACK, DON'T IMPORT INTO LOVEYLIB!
     case ConfigureNotify:
       if (c->pub.base.api == CANVAS_OPENGL_API) {
-        int x, y, width, height;
-        width = evt.xconfigure.width;
-        height = evt.xconfigure.height;
-
-        f32 color[4];
-        c->pub.gl.f.GetFloatv(gl::COLOR_CLEAR_VALUE, color);
-
-        c->pub.gl.f.Scissor(0, 0, width, height);
-        c->pub.gl.f.DrawBuffer(gl::FRONT_AND_BACK);
-        c->pub.gl.f.ClearColor(0, 0, 0, 0);
-        c->pub.gl.f.Clear(gl::COLOR_BUFFER_BIT);
-        c->pub.gl.f.DrawBuffer(gl::BACK);
-        c->pub.gl.f.ClearColor(color[0], color[1], color[2], color[3]);
-
-        const f32 ratio = (f32)width/(f32)height;
-        constexpr f32 GAME_RATIO = (f32)GAME_WIDTH/(f32)GAME_HEIGHT;
-        if (ratio >= GAME_RATIO) {
-          width = (f32)height*GAME_RATIO;
-          x = (evt.xconfigure.width-width)/2;
-          y = 0;
-        } else {
-          height = (f32)width/GAME_RATIO;
-          x = 0;
-          y = (evt.xconfigure.height-height)/2;
-        }
-
-        c->pub.gl.f.Viewport(x, y, width, height);
-        c->pub.gl.f.Scissor(x, y, width, height);
+        c->resize = ((u32)evt.xconfigure.width<<16)|(u32)evt.xconfigure.height;
       }
       break;
 
@@ -621,6 +603,7 @@ bfast CreateSoftwareCanvas(canvas_t *out, const char *title, u32 width, u32 heig
   c->g.pressCode = KEYC_NONE;
   c->g.map = NULL;
   c->g.winMapped = false;
+  c->g.resize = 0;
   c->segInfo.shmid = -1;
   c->img = NULL;
   c->gc = NULL;
@@ -759,10 +742,45 @@ struct xlib_gl_canvas_data_t {
 };
 static_assert(sizeof(xlib_gl_canvas_data_t) <= CANVAS_DATA_SIZE, "");
 
+// FANGAME HACK, DON'T IMPORT INTO LOVEYLIB!
+// Resize OpenGL viewport to fit game in window
+static void ResizeOpenGLViewport(gl::funcs_t *f, int winWidth, int winHeight) {
+  int x, y, width = winWidth, height = winHeight;
+
+  f32 color[4];
+  f->GetFloatv(gl::COLOR_CLEAR_VALUE, color);
+
+  f->Scissor(0, 0, width, height);
+  f->DrawBuffer(gl::FRONT_AND_BACK);
+  f->ClearColor(0, 0, 0, 0);
+  f->Clear(gl::COLOR_BUFFER_BIT);
+  f->DrawBuffer(gl::BACK);
+  f->ClearColor(color[0], color[1], color[2], color[3]);
+
+  const f32 ratio = (f32)width/(f32)height;
+  constexpr f32 GAME_RATIO = (f32)GAME_WIDTH/(f32)GAME_HEIGHT;
+  if (ratio >= GAME_RATIO) {
+    width = (f32)height*GAME_RATIO;
+    x = (winWidth-width)/2;
+    y = 0;
+  } else {
+    height = (f32)width/GAME_RATIO;
+    x = 0;
+    y = (winHeight-height)/2;
+  }
+
+  f->Viewport(x, y, width, height);
+  f->Scissor(x, y, width, height);
+}
+
 // Render OpenGL canvas
 static void RenderOpenGLCanvas(canvas_t *data) {
   xlib_gl_canvas_data_t *c = (xlib_gl_canvas_data_t*)data;
   glXSwapBuffers(c->g.dis, c->g.win);
+
+  // Resize viewport for next frame, if the window was resized
+  const u32 size = c->g.resize.exchange(0);
+  if (size) ResizeOpenGLViewport(&c->g.pub.gl.f, size>>16, size&0xffff);
 }
 
 // Close OpenGL canvas
@@ -791,6 +809,14 @@ static const canvas_funcs_t S_OpenGLCanvasFuncs = {
   PollXlibCanvasEvent, RenderOpenGLCanvas, CloseOpenGLCanvas
 };
 
+// Bind or release OpenGL canvas' context
+bfast BindOpenGLCanvas(canvas_t *data, bfast bind) {
+  xlib_gl_canvas_data_t *c = (xlib_gl_canvas_data_t*)data;
+
+  if (bind) return glXMakeCurrent(c->g.dis, c->g.win, c->ctx);
+  return glXMakeCurrent(c->g.dis, None, NULL);
+}
+
 // Check for existence of GLX extension
 static inline bptr GLXExtensionSupported(const char *extStr, const char *ext) {
   return (bptr)strstr(extStr, ext);
@@ -808,6 +834,7 @@ bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height
   c->g.pressCode = KEYC_NONE;
   c->g.map = NULL;
   c->g.winMapped = false;
+  c->g.resize = 0;
   c->g.cmap = (Colormap)-1;
   c->g.dis = NULL;
   c->ctx = NULL;
@@ -817,6 +844,12 @@ bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height
   c->g.pub.software.width = width;
   c->g.pub.software.height = height;
 
+#ifdef LOVEYLIB_THREADS
+  // The context may be bound on another thread, which then
+  // swaps buffers while this one polls events
+  XInitThreads();
+#endif
+
   c->g.dis = XOpenDisplay(NULL);
   if (!c->g.dis) return false;
 
@@ -936,4 +969,9 @@ bfast CreateOpenGLCanvas(canvas_t *out, const char *title, u32 width, u32 height
   return false;
 }
 
+bfast BindOpenGLCanvas(canvas_t *c, bfast bind) {
+  (void)c, (void)bind;
+  return false;
+}
+
 #endif //LOVEYLIB_OPENGL
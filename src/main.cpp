@@ -32,12 +32,15 @@
 #include "loveylib/timer.h"
 #include "loveylib/canvas.h"
 #include "loveylib/file.h"
+#include "loveylib/heap.h"
+#include "loveylib/job.h"
 #include "mem.h"
 #include "audio.h"
 #include "log.h"
 #include "str.h"
 #include "draw.h"
 #include "game.h"
+#include "pack.h"
 
 timestamp_t g_timerFrequency = 0;
 
@@ -46,18 +49,34 @@ static inline u32 TimeToMicro(timestamp_t time) {
 }
 
 // From str.h
-char g_fmtStr[FMTSTR_SIZE];
+thread_local char g_fmtStr[FMTSTR_SIZE];
 
 int main(int argc, char **argv) {
   // For now, unused
   (void)argc, (void)argv;
 
+  // Count page faults, gameplay shouldn't take many
+  IN_DEBUG(const uptr startFaults = GetPageFaultCount());
+
   AllocMem();
   InitTimer();
   InitLogStreams();
 
+  // Jobs run on the calling thread if there aren't any workers
+  InitJobs();
+  LOG_INFO(FMT.s("Job workers: ").i(GetJobWorkerCount()).STR);
+
   g_timerFrequency = GetTimerFrequency();
 
+  // Events are ignored if the telemetry file can't be written
+  if (!InitTelemetry()) LOG_STATUS("Couldn't open telemetry file");
+
+  // Reads are done right away if there's no async IO
+  if (!InitAsyncIO()) LOG_STATUS("No async IO, reads will block");
+
+  // Assets are read from loose files if there's no pack
+  OpenPack();
+
   canvas_t win;
   input_t input = {};
 
@@ -66,6 +85,10 @@ int main(int argc, char **argv) {
 
   InitGame();
 
+  // Page faults taken during gameplay are counted from here
+  IN_DEBUG(const uptr gameFaults = GetPageFaultCount());
+  LOG_INFO(FMT.s("Page faults during startup: ").i(gameFaults-startFaults).STR);
+
   event_t evt;
 
   // lshift and rshift are broken on windows
@@ -177,15 +200,20 @@ int main(int argc, char **argv) {
       lshiftPressed = lshiftReleased =
         rshiftPressed = rshiftReleased = false;
     }
-    RenderCanvas(&win);
+    // The frame is presented by RenderGame, possibly on the render thread
     UpdateAudio();
 
     const u32 end = TimeToMicro(GetTime());
+    LOG_EVENT(TEL_FRAME, end-start);
+    FlushTelemetry();
+
     if (end-start < 1000000/GAME_FPS)
       MicrosecondDelay(g_timerFrequency, 1000000/GAME_FPS - (end-start));
   }
 
 l_end:
+  LOG_INFO(FMT.s("Page faults during gameplay: ").i(GetPageFaultCount()-gameFaults).STR);
+
   // Before we shut down, write the game save to a file
   // Only write save data if it's valid
   stream_t saveFile = {};
@@ -198,6 +226,10 @@ l_end:
   FreeGame();
   CloseWindow(&win);
   FreeAudio();
+  ClosePack();
+  FreeAsyncIO();
+  FreeTelemetry();
+  FreeJobs();
   CloseLogStreams();
 
   return 0;
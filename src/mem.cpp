@@ -30,15 +30,40 @@
 
 #include "mem.h"
 #include "loveylib/heap.h"
+#include "log.h"
+#include "str.h"
 
-static constexpr const uptr MEM_SIZE = 16*1024*1024;
+// Address space reserved for g_arena, memory past
+// MEM_COMMIT_SIZE is only committed as it's needed
+static constexpr const uptr MEM_SIZE = (sizeof(uptr) >= 8) ? (uptr)1024*1024*1024 : 256*1024*1024;
+
+// Memory committed and faulted in up front, so gameplay
+// doesn't take page faults until it needs more than this
+static constexpr const uptr MEM_COMMIT_SIZE = 16*1024*1024;
 mem_arena_t *g_arena = NULL;
 
+u8 *g_scratch = NULL;
+uptr g_scratchTop = 0;
+
 void AllocMem() {
-  g_arena = (mem_arena_t*)InitHeap(MEM_SIZE);
-  InitMemoryArena(g_arena, MEM_SIZE);
+  g_arena = CreateGrowableArena(MEM_SIZE, MEM_COMMIT_SIZE,
+                                ARENA_RELEASE_BIT|ARENA_PREFAULT_BIT|ARENA_HUGE_PAGES_BIT);
+
+  g_scratch = (u8*)InitHeap(SCRATCH_SIZE, HEAP_PREFAULT_BIT);
+  g_scratchTop = 0;
 }
 
 void FreeMem() {
-  DestroyHeap((heap_t)g_arena);
+  DestroyHeap((heap_t)g_scratch);
+  DestroyGrowableArena(g_arena);
+}
+
+void LogAllocFailure(uptr size, const char *name) {
+  LOG_STATUS(FMT.s("Couldn't allocate ").i(size).s(" bytes for \"").s(name).s("\"!").STR);
+  DumpArena(g_arena, g_streams);
+}
+
+void LogScratchFailure(uptr size, const char *name) {
+  LOG_STATUS(FMT.s("Couldn't allocate ").i(size).s(" bytes of scratch memory for \"").s(name)
+             .s("\", ").i(g_scratchTop).s(" bytes in use!").STR);
 }
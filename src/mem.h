@@ -32,17 +32,78 @@
 #define _MEM_H
 
 #include "loveylib/mem.h"
+#include "log.h"
 
 extern mem_arena_t *g_arena;
 
 void AllocMem();
 void FreeMem();
 
+// Log failed allocation, and what's using the arena
+void LogAllocFailure(uptr size, const char *name);
+
 static inline void *Alloc(uptr size, const char *name = "", arena_alloc_flags_t flags = 0) {
-  return Alloc(g_arena, size, name, flags);
+  void *ret = Alloc(g_arena, size, name, flags);
+  LOG_EVENT(ret ? TEL_ALLOC : TEL_ALLOC_FAILED, (u32)size);
+  if (!ret) LogAllocFailure(size, name);
+
+  return ret;
 }
 static inline void Free(void *addr) {
   return Free(g_arena, addr);
 }
 
+/*
+ * Frame scratch memory
+ *
+ * Bump allocator for temporary allocations, which are all freed
+ * at the end of the frame by ResetScratch (called by UpdateGame).
+ * Allocating is an add, and can't fragment g_arena.
+ *
+ * A scratch_scope_t frees everything allocated after it was
+ * constructed once it goes out of scope, so temporaries can be
+ * freed before the end of the frame. Scopes can be nested.
+ *
+ * Only the game thread can use scratch memory.
+ */
+
+// Scratch memory size
+static constexpr const uptr SCRATCH_SIZE = 1024*1024;
+
+extern u8 *g_scratch;
+extern uptr g_scratchTop; // Bytes allocated
+
+// Log failed scratch allocation
+void LogScratchFailure(uptr size, const char *name);
+
+// Allocate temporary memory, aligned to ARENA_ALIGNMENT
+// Returns NULL if there isn't enough scratch memory left
+static inline void *ScratchAlloc(uptr size, const char *name = "") {
+  size = AlignUpPow2(size, ARENA_ALIGNMENT);
+  if (size > SCRATCH_SIZE-g_scratchTop) {
+    LogScratchFailure(size, name);
+    return NULL;
+  }
+
+  void *ret = g_scratch+g_scratchTop;
+  g_scratchTop += size;
+  return ret;
+}
+
+// Scratch scope, frees scratch allocations made during its lifetime
+struct scratch_scope_t {
+  uptr top;
+
+  inline scratch_scope_t() : top(g_scratchTop) {}
+  inline ~scratch_scope_t() {g_scratchTop = top;}
+
+  scratch_scope_t(const scratch_scope_t&) = delete;
+  scratch_scope_t &operator=(const scratch_scope_t&) = delete;
+};
+
+// Free all scratch allocations
+static inline void ResetScratch() {
+  g_scratchTop = 0;
+}
+
 #endif //_MEM_H
@@ -0,0 +1,186 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#include "loveylib/types.h"
+#include "loveylib/file.h"
+#include "loveylib/assert.h"
+#include "log.h"
+#include "str.h"
+#include "pack.h"
+
+#include <cstring>
+
+// Mapped pack file, data is NULL if there's no pack
+// The pack is kept open for asset files
+static stream_t s_packFile;
+static mapped_file_t s_pack;
+static const pack_entry_t *s_entries;
+static u32 s_entryCount;
+
+// Check pack directory
+// Returns false if the pack is invalid
+static bfast CheckPack() {
+  if (s_pack.size < sizeof(pack_hdr_t)) return false;
+
+  pack_hdr_t hdr;
+  memcpy(&hdr, s_pack.data, sizeof(hdr));
+  hdr.swap();
+
+  if ((hdr.magic != PACK_MAGIC) ||
+      (hdr.version != PACK_VERSION) ||
+      (hdr.entryCount > (s_pack.size-sizeof(hdr))/sizeof(pack_entry_t)))
+    return false;
+
+  s_entries = (const pack_entry_t*)(s_pack.data+sizeof(hdr));
+  s_entryCount = hdr.entryCount;
+
+  // Make sure every entry is in the pack and aligned, since
+  // rooms are used in place, and the directory is sorted
+  u32 lastHash = 0;
+  for (u32 i = 0; i < s_entryCount; ++i) {
+    pack_entry_t e = s_entries[i];
+    e.swap();
+
+    if ((e.offset > s_pack.size) || (s_pack.size-e.offset < e.size) ||
+        (e.offset % PACK_ALIGNMENT) ||
+        (e.hash < lastHash) || !memchr(e.name, 0, PACK_NAME_LENGTH))
+      return false;
+
+    lastHash = e.hash;
+  }
+
+  return true;
+}
+
+bfast OpenPack() {
+  s_pack.data = NULL;
+
+  s_packFile.init();
+  if (!OpenFile(&s_packFile, PACK_FILENAME, FILE_READ_ONLY)) return false;
+
+  if (!MapFile(&s_pack, &s_packFile)) {
+    s_pack.data = NULL;
+    ClosePack();
+    return false;
+  }
+
+  if (!CheckPack()) {
+    LOG_STATUS("Invalid pack file, using loose files");
+    ClosePack();
+    return false;
+  }
+
+  LOG_INFO(FMT.s("Pack has ").i(s_entryCount).s(" assets").STR);
+  return true;
+}
+
+void ClosePack() {
+  if (s_pack.data) UnmapFile(&s_pack);
+  if (s_packFile.open()) CloseFile(&s_packFile);
+
+  s_entries = NULL;
+  s_entryCount = 0;
+}
+
+// Find asset in pack
+// Returns NULL if it isn't in the pack
+static const pack_entry_t *FindAsset(const char *name) {
+  const u32 hash = HashAssetName(name);
+
+  // Find first entry with hash
+  u32 first = 0, last = s_entryCount;
+  while (first < last) {
+    const u32 mid = first + (last-first)/2;
+    if (LittleEndian32(s_entries[mid].hash) < hash) first = mid+1;
+    else last = mid;
+  }
+
+  for (; (first < s_entryCount) && (LittleEndian32(s_entries[first].hash) == hash); ++first)
+    if (!strcmp(s_entries[first].name, name)) return s_entries+first;
+
+  return NULL;
+}
+
+bfast MapAsset(mapped_file_t *out, const char *name) {
+  const pack_entry_t *e = FindAsset(name);
+  if (e) {
+    out->data = s_pack.data + LittleEndian64(e->offset);
+    out->size = LittleEndian32(e->size);
+    out->mapped = false;
+
+    return true;
+  }
+
+  return MapFile(out, name);
+}
+
+void UnmapAsset(mapped_file_t *file) {
+  // Assets in the pack stay mapped with it
+  if (s_pack.data && (file->data >= s_pack.data) && (file->data <= s_pack.data+s_pack.size)) {
+    file->data = NULL;
+    file->size = 0;
+    return;
+  }
+
+  UnmapFile(file);
+}
+
+bfast OpenAssetFile(asset_file_t *out, const char *name) {
+  out->loose.init();
+
+  const pack_entry_t *e = FindAsset(name);
+  if (e) {
+    out->file = &s_packFile;
+    out->offset = LittleEndian64(e->offset);
+    out->size = LittleEndian32(e->size);
+
+    return true;
+  }
+
+  if (!OpenFile(&out->loose, name, FILE_READ_ONLY)) return false;
+
+  const iptr size = SeekStream(&out->loose, 0, ORIGIN_END) ? TellStream(&out->loose) : -1;
+  if (size < 0) {
+    CloseFile(&out->loose);
+    return false;
+  }
+
+  out->file = &out->loose;
+  out->offset = 0;
+  out->size = size;
+
+  return true;
+}
+
+void CloseAssetFile(asset_file_t *f) {
+  if (f->loose.open()) CloseFile(&f->loose);
+  f->file = NULL;
+}
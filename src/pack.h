@@ -0,0 +1,139 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#ifndef _PACK_H
+#define _PACK_H
+
+#include "loveylib/types.h"
+#include "loveylib/endian.h"
+#include "loveylib/file.h"
+
+/*
+ * Pack file
+ *
+ * Assets can all be stored in one pack file, PACK_FILENAME,
+ * so starting the game opens and maps one file instead of
+ * every asset. Packs are made by toPack.
+ *
+ * A pack starts with a pack_hdr_t, followed by entryCount
+ * pack_entry_t's sorted by the hash of their name. The data
+ * of each entry follows, aligned to PACK_ALIGNMENT.
+ *
+ * Assets are looked up in the pack first, and opened as loose
+ * files if they aren't in it, or if there's no pack.
+ *
+ * The pack stays open while it's mapped, so assets that are
+ * streamed can be read from it with SubmitRead instead.
+ */
+
+static constexpr const char * const PACK_FILENAME = "data.pak";
+
+static constexpr const u32 PACK_MAGIC = CLITTLE_ENDIAN32('I' | ('W'<<8) | ('P'<<16) | ('K'<<24));
+static constexpr const u16 PACK_VERSION = 1;
+
+// Entries are aligned to this many bytes
+static constexpr const uptr PACK_ALIGNMENT = 4096;
+
+// Longest asset name, counting the terminator
+static constexpr const uptr PACK_NAME_LENGTH = 48;
+
+struct pack_hdr_t {
+  u32 magic; // == PACK_MAGIC
+  u16 version; // == PACK_VERSION
+  u16 pad;
+  u32 entryCount;
+  u32 pad2;
+
+  inline void swap() {
+    version = LittleEndian16(version);
+    entryCount = LittleEndian32(entryCount);
+  }
+};
+
+struct pack_entry_t {
+  u32 hash; // HashAssetName(name)
+  u32 size;
+  u64 offset; // From the start of the pack
+
+  char name[PACK_NAME_LENGTH];
+
+  inline void swap() {
+    hash = LittleEndian32(hash);
+    size = LittleEndian32(size);
+    offset = LittleEndian64(offset);
+  }
+};
+static_assert(sizeof(pack_entry_t) == 64, "");
+
+// FNV-1a hash of asset name
+static inline u32 HashAssetName(const char *name) {
+  u32 ret = 0x811c9dc5;
+  for (; *name; ++name) ret = (ret^(u8)*name)*0x1000193;
+
+  return ret;
+}
+
+// Open and map pack file
+// Returns false if there's no valid pack, assets are
+// opened as loose files in that case
+bfast OpenPack();
+
+// Close pack file, every asset in it must be unmapped
+void ClosePack();
+
+// Map asset, from the pack or as a loose file
+// Returns false if the asset can't be found
+// For a stream over the asset, open a memory stream over it
+bfast MapAsset(mapped_file_t *out, const char *name);
+
+// Unmap asset mapped by MapAsset
+void UnmapAsset(mapped_file_t *file);
+
+// Asset opened for reads, see OpenAssetFile
+struct asset_file_t {
+  // File the asset is in, either the pack or loose
+  stream_t *file;
+
+  // Where the asset is in file
+  u64 offset;
+  uptr size;
+
+  // Loose file, if the asset isn't in the pack
+  stream_t loose;
+};
+
+// Open asset for ReadFileAt and SubmitRead, without mapping it
+// Returns false if the asset can't be found
+bfast OpenAssetFile(asset_file_t *out, const char *name);
+
+// Close asset opened by OpenAssetFile
+void CloseAssetFile(asset_file_t *f);
+
+#endif //_PACK_H
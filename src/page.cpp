@@ -0,0 +1,454 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#include "loveylib/types.h"
+#include "loveylib/endian.h"
+#include "loveylib/vector.h"
+#include "loveylib_config.h"
+#include "page.h"
+
+#include <cstring>
+
+static inline bfast IsMarker(u32 pixel) {
+  return (pixel&CBIG_ENDIAN32(0xff)) == CBIG_ENDIAN32(0x80);
+}
+
+static inline u32 MarkerLength(u32 marker) {
+  return LittleEndian32(marker)&0xffffff;
+}
+
+#if defined(LOVEYLIB_SSE) && defined(LOVEYLIB_LITTLE)
+
+// Index of the lowest set bit in a 4-bit movemask
+static const u8 S_FirstSet[16] = {
+  4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+// Get mask of marker words in w, one bit per word
+static inline u32 MarkerMask(__m128i w) {
+  const __m128i alpha = _mm_set1_epi32((i32)CBIG_ENDIAN32(0xff));
+  const __m128i magic = _mm_set1_epi32((i32)CBIG_ENDIAN32(0x80));
+
+  return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w, alpha), magic)));
+}
+
+// Write pixel n times
+static inline u32 *FillPixels(u32 *out, u32 pixel, uptr n) {
+  const __m128i p = _mm_set1_epi32((i32)pixel);
+
+  for (; n >= 8; n -= 8, out += 8) {
+    _mm_storeu_si128((__m128i*)out, p);
+    _mm_storeu_si128((__m128i*)(out+4), p);
+  }
+  if (n >= 4) {
+    _mm_storeu_si128((__m128i*)out, p);
+    n -= 4, out += 4;
+  }
+  while (n--) *out++ = pixel;
+
+  return out;
+}
+
+// Copy literal pixels until a marker, the end of the input
+// or the end of the output
+static inline u32 *CopyLiterals(const u32 **inp, const u32 *inEnd, u32 *out, u32 *end) {
+  const u32 *in = *inp;
+
+  while ((inEnd-in >= 8) && (end-out >= 8)) {
+    const __m128i a = _mm_loadu_si128((const __m128i*)in);
+    const __m128i b = _mm_loadu_si128((const __m128i*)(in+4));
+    const u32 mask = MarkerMask(a) | (MarkerMask(b)<<4);
+
+    // There's room for all 8 words in the output, so they're
+    // always stored, only the literals before the marker
+    // are kept
+    _mm_storeu_si128((__m128i*)out, a);
+    _mm_storeu_si128((__m128i*)(out+4), b);
+
+    if (mask) {
+      const uptr n = (mask&0xf) ? S_FirstSet[mask&0xf] : 4+S_FirstSet[mask>>4];
+      *inp = in+n;
+      return out+n;
+    }
+
+    in += 8, out += 8;
+  }
+
+  // Tail
+  while ((in != inEnd) && (out != end) && !IsMarker(*in)) *out++ = *in++;
+
+  *inp = in;
+  return out;
+}
+
+#else //SSE
+
+// Write pixel n times
+static inline u32 *FillPixels(u32 *out, u32 pixel, uptr n) {
+  while (n--) *out++ = pixel;
+  return out;
+}
+
+// Copy literal pixels until a marker, the end of the input
+// or the end of the output
+static inline u32 *CopyLiterals(const u32 **inp, const u32 *inEnd, u32 *out, u32 *end) {
+  const u32 *in = *inp;
+
+  while ((in != inEnd) && (out != end) && !IsMarker(*in)) *out++ = *in++;
+
+  *inp = in;
+  return out;
+}
+
+#endif //SSE
+
+void InitRLEDecoder(rle_decoder_t *d) {
+  d->in = d->inEnd = NULL;
+  d->repCnt = 0;
+  d->repPixel = 0;
+}
+
+uptr DecodeRLE(rle_decoder_t *d, u32 *out, uptr count) {
+  u32 * const start = out;
+  u32 * const end = out+count;
+  const u32 *in = d->in;
+  const u32 * const inEnd = d->inEnd;
+
+  for (;;) {
+    // Finish pending repeat run
+    if (d->repCnt) {
+      uptr n = d->repCnt;
+      if (n > (uptr)(end-out)) n = end-out;
+
+      out = FillPixels(out, d->repPixel, n);
+      d->repCnt -= n;
+
+      if (d->repCnt) break;
+    }
+
+    out = CopyLiterals(&in, inEnd, out, end);
+    if ((out == end) || (in == inEnd)) break;
+
+    // Next word is a marker, wait for it's pixel if
+    // it isn't in this chunk
+    if (inEnd-in < 2) break;
+
+    d->repCnt = MarkerLength(in[0])+1;
+    d->repPixel = in[1];
+    in += 2;
+  }
+
+  d->in = in;
+  return out-start;
+}
+
+/*
+ * LZ codec
+ *
+ * Same block format as LZ4: a token byte holding the literal
+ * count in the high nibble and the match length-4 in the low
+ * nibble, either extended by bytes of 255 when they're 15. The
+ * literals follow, then a 16-bit match offset. The last
+ * sequence of a block only has literals.
+ */
+static constexpr const uptr LZ_MIN_MATCH = 4;
+static constexpr const uptr LZ_MAX_OFFSET = 65535;
+static constexpr const uptr LZ_LAST_LITERALS = 5;
+
+static inline u32 Read32(const u8 *p) {
+  u32 ret;
+  memcpy(&ret, p, 4);
+  return ret;
+}
+
+static inline u32 HashLZ(u32 v) {
+  return (v*2654435761u) >> 16;
+}
+
+// Write extended length of 15 or more
+static inline u8 *WriteLZLength(u8 *out, uptr len) {
+  for (len -= 15; len >= 255; len -= 255) *out++ = 255;
+  *out++ = (u8)len;
+  return out;
+}
+
+// Read extended length, adding it to *len
+static inline bfast ReadLZLength(const u8 **inp, const u8 *inEnd, uptr *len) {
+  const u8 *in = *inp;
+  u8 b;
+
+  do {
+    if (in == inEnd) return false;
+    b = *in++;
+    *len += b;
+  } while (b == 255);
+
+  *inp = in;
+  return true;
+}
+
+// Write sequence of literals, followed by a match if len != 0
+static inline u8 *WriteLZSequence(u8 *out, const u8 *lits, uptr litCount, uptr offset, uptr len) {
+  u8 * const token = out++;
+
+  *token = (u8)(((litCount >= 15) ? 15 : litCount) << 4);
+  if (litCount >= 15) out = WriteLZLength(out, litCount);
+
+  memcpy(out, lits, litCount);
+  out += litCount;
+
+  if (len) {
+    *out++ = (u8)offset;
+    *out++ = (u8)(offset>>8);
+
+    len -= LZ_MIN_MATCH;
+    *token |= (len >= 15) ? 15 : len;
+    if (len >= 15) out = WriteLZLength(out, len);
+  }
+
+  return out;
+}
+
+// Compress size bytes from in, with a greedy single-entry
+// hash table match finder
+// Returns compressed size
+static uptr EncodeLZ(u32 *table, const u8 *in, uptr size, u8 *out) {
+  u8 * const start = out;
+  const u8 * const end = in+size;
+  const u8 * const matchLimit = (size > LZ_LAST_LITERALS+LZ_MIN_MATCH) ? end-LZ_LAST_LITERALS : in;
+  const u8 *ip = in, *anchor = in;
+
+  // Table holds position+1, 0 == empty
+  memset(table, 0, sizeof(u32)<<16);
+
+  while (ip+LZ_MIN_MATCH <= matchLimit) {
+    const u32 v = Read32(ip);
+    const u32 h = HashLZ(v);
+    const uptr pos = ip-in;
+    const uptr cand = table[h];
+    table[h] = (u32)pos+1;
+
+    if (!cand || (pos+1-cand > LZ_MAX_OFFSET) || (Read32(in+cand-1) != v)) {
+      ++ip;
+      continue;
+    }
+
+    const u8 * const match = in+cand-1;
+    uptr len = LZ_MIN_MATCH;
+    while ((ip+len < matchLimit) && (ip[len] == match[len])) ++len;
+
+    out = WriteLZSequence(out, anchor, ip-anchor, ip-match, len);
+    ip += len;
+    anchor = ip;
+  }
+
+  out = WriteLZSequence(out, anchor, end-anchor, 0, 0);
+  return out-start;
+}
+
+// Copy len bytes from match to out, match may overlap out
+static inline u8 *CopyLZMatch(u8 *out, const u8 *match, uptr len) {
+  // Copy the repeating pattern, doubling it each time, so
+  // memcpy never overlaps
+  while (len > (uptr)(out-match)) {
+    const uptr n = out-match;
+    memcpy(out, match, n);
+    out += n;
+    len -= n;
+  }
+
+  memcpy(out, match, len);
+  return out+len;
+}
+
+// Decompress block into exactly outSize bytes
+// Returns false if the block is corrupt
+static bfast DecodeLZ(const u8 *in, uptr size, u8 *out, uptr outSize) {
+  const u8 * const inEnd = in+size;
+  u8 * const start = out;
+  u8 * const end = out+outSize;
+
+  for (;;) {
+    if (in == inEnd) return false;
+    const u8 token = *in++;
+
+    uptr lits = token>>4;
+    if ((lits == 15) && !ReadLZLength(&in, inEnd, &lits)) return false;
+    if (((uptr)(inEnd-in) < lits) || ((uptr)(end-out) < lits)) return false;
+
+    memcpy(out, in, lits);
+    in += lits;
+    out += lits;
+
+    // Last sequence
+    if (in == inEnd) break;
+
+    if (inEnd-in < 2) return false;
+    const uptr offset = in[0] | (in[1]<<8);
+    in += 2;
+
+    uptr len = token&0xf;
+    if ((len == 15) && !ReadLZLength(&in, inEnd, &len)) return false;
+    len += LZ_MIN_MATCH;
+
+    if (!offset || (offset > (uptr)(out-start)) || ((uptr)(end-out) < len)) return false;
+    out = CopyLZMatch(out, out-offset, len);
+  }
+
+  return out == end;
+}
+
+/*
+ * Band filters
+ *
+ * Pixels are added and subtracted byte-wise, so each channel
+ * wraps on it's own.
+ */
+static inline u32 AddBytes(u32 a, u32 b) {
+  return ((a&0x7f7f7f7f) + (b&0x7f7f7f7f)) ^ ((a^b)&0x80808080);
+}
+
+static inline u32 SubBytes(u32 a, u32 b) {
+  return ((a|0x80808080) - (b&0x7f7f7f7f)) ^ ((a^~b)&0x80808080);
+}
+
+// Filter band from pixels into out
+static void FilterBand(const u32 *pixels, u32 *out, page_filter_t filter) {
+  switch (filter) {
+  case PAGE_FILTER_LEFT:
+    for (uptr y = 0; y < PAGE_BAND_HEIGHT; ++y) {
+      const u32 * const row = pixels + y*PAGE_WIDTH;
+      u32 * const o = out + y*PAGE_WIDTH;
+
+      o[0] = row[0];
+      for (uptr x = 1; x < PAGE_WIDTH; ++x) o[x] = SubBytes(row[x], row[x-1]);
+    }
+    break;
+
+  case PAGE_FILTER_UP:
+    memcpy(out, pixels, PAGE_WIDTH*4);
+    for (uptr i = PAGE_WIDTH; i < PAGE_BAND_PIXELS; ++i)
+      out[i] = SubBytes(pixels[i], pixels[i-PAGE_WIDTH]);
+    break;
+
+  default:
+    memcpy(out, pixels, PAGE_BAND_PIXELS*4);
+    break;
+  }
+}
+
+// Undo band filter in place
+static void UnfilterBand(u32 *pixels, page_filter_t filter) {
+  switch (filter) {
+  case PAGE_FILTER_LEFT:
+    for (uptr y = 0; y < PAGE_BAND_HEIGHT; ++y) {
+      u32 * const row = pixels + y*PAGE_WIDTH;
+
+      u32 prev = row[0];
+      for (uptr x = 1; x < PAGE_WIDTH; ++x) row[x] = prev = AddBytes(row[x], prev);
+    }
+    break;
+
+  case PAGE_FILTER_UP:
+#if defined(LOVEYLIB_SSE) && defined(LOVEYLIB_LITTLE)
+    for (uptr i = PAGE_WIDTH; i < PAGE_BAND_PIXELS; i += 4) {
+      const __m128i above = _mm_loadu_si128((const __m128i*)(pixels+i-PAGE_WIDTH));
+      const __m128i cur = _mm_loadu_si128((const __m128i*)(pixels+i));
+      _mm_storeu_si128((__m128i*)(pixels+i), _mm_add_epi8(cur, above));
+    }
+#else
+    for (uptr i = PAGE_WIDTH; i < PAGE_BAND_PIXELS; ++i)
+      pixels[i] = AddBytes(pixels[i], pixels[i-PAGE_WIDTH]);
+#endif
+    break;
+
+  default: break;
+  }
+}
+
+/*
+ * Page file v2
+ */
+bfast ReadPageTable(const u8 *file, uptr size, page_band_t *bands) {
+  if (size < PAGE_TABLE_SIZE) return false;
+
+  page_hdr_t hdr;
+  memcpy(&hdr, file, sizeof(hdr));
+  hdr.swap();
+
+  if ((hdr.magic != PAGE_MAGIC) ||
+      (hdr.version != PAGE_VERSION) ||
+      (hdr.bandCount != PAGE_BANDS) ||
+      (hdr.width != PAGE_WIDTH) ||
+      (hdr.height != PAGE_HEIGHT))
+    return false;
+
+  memcpy(bands, file+sizeof(hdr), sizeof(page_band_t)*PAGE_BANDS);
+  for (uptr i = 0; i < PAGE_BANDS; ++i) {
+    bands[i].swap();
+
+    if ((bands[i].offset > size) || (size-bands[i].offset < bands[i].size))
+      return false;
+  }
+
+  return true;
+}
+
+bfast DecodePageBand(const u8 *in, uptr size, u32 *out) {
+  if (!size || (in[0] >= PAGE_FILTER_COUNT)) return false;
+
+  if (!DecodeLZ(in+1, size-1, (u8*)out, PAGE_BAND_PIXELS*4)) return false;
+  UnfilterBand(out, in[0]);
+
+  return true;
+}
+
+uptr EncodePageBand(page_encoder_t *e, const u32 *pixels, const u8 **out) {
+  uptr best = 0, bestBuf = 0;
+
+  for (page_filter_t f = 0; f < PAGE_FILTER_COUNT; ++f) {
+    // Don't overwrite the best band so far
+    const uptr buf = best ? bestBuf^1 : 0;
+    u8 * const o = e->out[buf];
+
+    FilterBand(pixels, e->filtered, f);
+    o[0] = (u8)f;
+    const uptr size = 1+EncodeLZ(e->table, (const u8*)e->filtered, PAGE_BAND_PIXELS*4, o+1);
+
+    if (!best || (size < best)) {
+      best = size;
+      bestBuf = buf;
+    }
+  }
+
+  *out = e->out[bestBuf];
+  return best;
+}
@@ -0,0 +1,168 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#ifndef _PAGE_H
+#define _PAGE_H
+
+#include "loveylib/types.h"
+#include "loveylib/endian.h"
+
+// Page dimensions, pages are stored and uploaded in bands of rows
+static constexpr const uptr PAGE_WIDTH = 2048;
+static constexpr const uptr PAGE_HEIGHT = 2048;
+static constexpr const uptr PAGE_BAND_HEIGHT = 128;
+static constexpr const uptr PAGE_BANDS = PAGE_HEIGHT/PAGE_BAND_HEIGHT;
+static constexpr const uptr PAGE_BAND_PIXELS = PAGE_WIDTH*PAGE_BAND_HEIGHT;
+
+/*
+ * RLE texture page decoder
+ *
+ * Compressed pages are a stream of 32-bit BGRA pixels. A word
+ * with an alpha byte of 0x80 is a marker instead: the low 24
+ * bits (little endian) are a repeat count, and the next word
+ * is the pixel to write count+1 times.
+ *
+ * The decoder works on memory, input can be fed to it in
+ * chunks of any size, and output can be taken in chunks of
+ * any size.
+ */
+struct rle_decoder_t {
+  // Input words not consumed yet
+  const u32 *in, *inEnd;
+
+  // Pending repeat run, 0 == not repeating
+  u32 repCnt;
+  u32 repPixel;
+};
+
+// Reset decoder to the start of a page
+void InitRLEDecoder(rle_decoder_t *d);
+
+// Set decoder's next input chunk
+// Any input left over from the last chunk is dropped,
+// see RLEInputLeft
+static inline void FeedRLEDecoder(rle_decoder_t *d, const u32 *in, uptr words) {
+  d->in = in;
+  d->inEnd = in+words;
+}
+
+// Number of input words the decoder hasn't consumed,
+// these have to be fed again along with the next chunk
+static inline uptr RLEInputLeft(const rle_decoder_t *d) {
+  return d->inEnd-d->in;
+}
+
+// Decode up to count pixels into out
+// Stops early if it runs out of input, a marker at the end of
+// the input without it's pixel is left unconsumed
+// Returns number of pixels written
+uptr DecodeRLE(rle_decoder_t *d, u32 *out, uptr count);
+
+/*
+ * Page file v2
+ *
+ * A header, followed by a table of bands, followed by the band
+ * data. Every band is compressed on it's own, so bands can be
+ * decoded in any order, and in parallel.
+ *
+ * Band data is a filter byte, followed by an LZ4-style block
+ * of the filtered band. All fields are little endian.
+ */
+static constexpr const u32 PAGE_MAGIC = CLITTLE_ENDIAN32('I' | ('W'<<8) | ('P'<<16) | ('G'<<24));
+static constexpr const u16 PAGE_VERSION = 2;
+
+struct page_hdr_t {
+  u32 magic; // == PAGE_MAGIC
+  u16 version; // == PAGE_VERSION
+  u16 bandCount; // == PAGE_BANDS
+  u32 width; // == PAGE_WIDTH
+  u32 height; // == PAGE_HEIGHT
+
+  inline void swap() {
+    version = LittleEndian16(version);
+    bandCount = LittleEndian16(bandCount);
+    width = LittleEndian32(width);
+    height = LittleEndian32(height);
+  }
+};
+
+struct page_band_t {
+  u32 offset; // From the start of the file
+  u32 size; // Including the filter byte
+
+  inline void swap() {
+    offset = LittleEndian32(offset);
+    size = LittleEndian32(size);
+  }
+};
+
+// Band filters, applied before compression
+// Filtered pixels are the byte-wise difference from a neighbour
+#define page_filter_e page_filter_e : ufast
+enum page_filter_e {
+  PAGE_FILTER_NONE = 0,
+  PAGE_FILTER_LEFT, // Difference from the pixel to the left
+  PAGE_FILTER_UP, // Difference from the pixel above
+
+  PAGE_FILTER_COUNT
+};
+#undef page_filter_e
+typedef ufast page_filter_t;
+
+// Largest possible compressed band, including the filter byte
+static constexpr const uptr PAGE_BAND_BOUND = 1 + PAGE_BAND_PIXELS*4 + PAGE_BAND_PIXELS*4/255 + 16;
+
+// Size of the header and band table
+static constexpr const uptr PAGE_TABLE_SIZE = sizeof(page_hdr_t) + sizeof(page_band_t)*PAGE_BANDS;
+
+// Read page header and band table from the start of a v2 page
+// file, checking every band is inside the file
+// Returns false if the file isn't a valid v2 page
+bfast ReadPageTable(const u8 *file, uptr size, page_band_t *bands);
+
+// Decode band into out, PAGE_BAND_PIXELS pixels
+// Returns false if the band is corrupt
+bfast DecodePageBand(const u8 *in, uptr size, u32 *out);
+
+// Page band encoder scratch, too big for the stack
+struct page_encoder_t {
+  u32 table[1<<16]; // Match finder hash table
+  u32 filtered[PAGE_BAND_PIXELS];
+  u8 out[2][PAGE_BAND_BOUND];
+};
+
+// Compress band of PAGE_BAND_PIXELS pixels, trying every filter
+// *out is set to the compressed band, which stays valid until
+// the next call
+// Returns size of the compressed band
+uptr EncodePageBand(page_encoder_t *e, const u32 *pixels, const u8 **out);
+
+#endif //_PAGE_H
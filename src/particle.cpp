@@ -0,0 +1,91 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#include "loveylib/types.h"
+#include "loveylib/vector.h"
+#include "loveylib/utils.h"
+#include "loveylib/assert.h"
+#include "particle.h"
+#include "draw.h"
+
+#include <cstring>
+
+// Number of particle arrays
+static constexpr const uptr PARTICLE_ARRAYS = 5;
+
+particle_system_t *CreateParticleSystem(void *mem, uptr size) {
+  ASSERT(!((uptr)mem&15));
+
+  // Arrays start after the header, aligned for vec4
+  const uptr hdrSize = AlignUpPow2(sizeof(particle_system_t), sizeof(vec4));
+  if (size < hdrSize) return NULL;
+
+  const uptr capacity = AlignDownPow2((size-hdrSize)/(sizeof(f32)*PARTICLE_ARRAYS), PARTICLE_GROUP);
+  if (!capacity) return NULL;
+
+  particle_system_t *ret = (particle_system_t*)mem;
+  f32 *arrays = (f32*)((u8*)mem + hdrSize);
+
+  // Zero arrays, so unused particles in the last
+  // group never hold denormals or NaNs
+  memset(arrays, 0, capacity*sizeof(f32)*PARTICLE_ARRAYS);
+
+  ret->count = 0;
+  ret->capacity = capacity;
+  ret->x = arrays;
+  ret->y = arrays + capacity;
+  ret->vx = arrays + capacity*2;
+  ret->vy = arrays + capacity*3;
+  ret->gravity = arrays + capacity*4;
+
+  return ret;
+}
+
+void UpdateParticles(particle_system_t *ps) {
+  vec4 *x = (vec4*)ps->x, *y = (vec4*)ps->y;
+  vec4 *vx = (vec4*)ps->vx, *vy = (vec4*)ps->vy;
+  const vec4 *gravity = (const vec4*)ps->gravity;
+
+  // Update whole groups, the last one may have unused
+  // particles, which don't matter
+  const uptr groups = CeilDiv(ps->count, PARTICLE_GROUP);
+  for (uptr i = 0; i < groups; ++i) {
+    x[i] += vx[i];
+    y[i] += vy[i];
+    vy[i] += gravity[i];
+  }
+}
+
+void DrawParticles(const particle_system_t *ps, const rquad_t *quad) {
+  if (!ps->count) return;
+
+  DrawQuadInstances(quad, ps->x, ps->y, ps->count);
+}
@@ -0,0 +1,94 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#ifndef _PARTICLE_H
+#define _PARTICLE_H
+
+#include "loveylib/types.h"
+#include "loveylib/vector.h"
+#include "vertex.h"
+
+/*
+ * Particle system
+ *
+ * Particles are stored as a structure of arrays, so they're
+ * moved a vec4 (PARTICLE_GROUP particles) at a time. Every
+ * particle is drawn as the same quad, which is only expanded
+ * when it's drawn.
+ *
+ * Each frame, a particle moves by its velocity, then gravity
+ * is added to its vertical velocity.
+ */
+
+// Particles updated at once
+static constexpr const uptr PARTICLE_GROUP = 4;
+
+struct particle_system_t {
+  uptr count;
+  uptr capacity; // Multiple of PARTICLE_GROUP
+
+  // Arrays of capacity particles
+  f32 *x, *y;
+  f32 *vx, *vy;
+  f32 *gravity;
+};
+
+// Create particle system in mem, with as many
+// particles as fit in size bytes
+// mem must be aligned to 16 bytes
+//
+// Returns NULL if mem is too small
+particle_system_t *CreateParticleSystem(void *mem, uptr size);
+
+// Add particle to particle system
+// Returns false if it's full
+static inline bfast AddParticle(particle_system_t *ps, f32 x, f32 y,
+                                f32 vx, f32 vy, f32 gravity)
+{
+  if (ps->count >= ps->capacity) return false;
+
+  const uptr i = ps->count++;
+  ps->x[i] = x;
+  ps->y[i] = y;
+  ps->vx[i] = vx;
+  ps->vy[i] = vy;
+  ps->gravity[i] = gravity;
+
+  return true;
+}
+
+// Move all particles
+void UpdateParticles(particle_system_t *ps);
+
+// Draw all particles, as quad offset by each particle's position
+void DrawParticles(const particle_system_t *ps, const rquad_t *quad);
+
+#endif //_PARTICLE_H
@@ -36,9 +36,10 @@
 #include "loveylib/file.h"
 #include "loveylib/endian.h"
 #include "loveylib/timer.h"
+#include "loveylib/thread.h"
+#include "loveylib/atomic.h"
 
 #include <alsa/asoundlib.h>
-#include <pthread.h>
 
 #include <alloca.h>
 
@@ -64,12 +65,12 @@ struct sound_channel {
 #define A_SOUND_BUF_SIZE 6873504
 
 static bfast a_bgm = false;
-static char a_bgmName[64];
+static asset_id_t a_bgmId = ASSET_NONE;
 static char a_errbuf[256]; // Error string
-static pthread_mutex_t a_m = PTHREAD_MUTEX_INITIALIZER;
+static light_mutex_t a_m;
 static i16 *a_samples; // Sample buffer
-static pthread_cond_t a_c = PTHREAD_COND_INITIALIZER;
-static pthread_t a_tid; // Audio thread index
+static light_event_t a_ready; // Set once the audio thread is initialized
+static thread_t a_thread; // Audio thread
 static volatile bfast a_quit = false; // Tells audio thread to exit infinite loop
 static volatile timestamp_t a_bufPlayTime; // Time when buffer started being handled
 
@@ -85,20 +86,20 @@ static snd_pcm_t *a_init(void) {
 #define alsaCheck(_ret, ...)                                \
   if ((err = (_ret)) < 0) {                                 \
     sprintf(a_errbuf, __VA_ARGS__, err, snd_strerror(err)); \
-    pthread_cond_signal(&a_c);                              \
+    SetLightEvent(&a_ready);                                \
     snd_pcm_close(handle);                                  \
     return NULL;                                            \
   }
 #define alsaCheckNoClose(_ret, ...)                         \
   if ((err = (_ret)) < 0) {                                 \
     sprintf(a_errbuf, __VA_ARGS__, err, snd_strerror(err)); \
-    pthread_cond_signal(&a_c);                              \
+    SetLightEvent(&a_ready);                                \
     return NULL;                                            \
   }
 #define condCheck(_cond, ...)                   \
   if (_cond) {                                  \
     sprintf(a_errbuf, __VA_ARGS__);             \
-    pthread_cond_signal(&a_c);                  \
+    SetLightEvent(&a_ready);                    \
     return NULL;                                \
   }
 
@@ -144,7 +145,7 @@ static snd_pcm_t *a_init(void) {
             "Error playing dummy samples! (%d, %s)\n");
 
   // ALSA successfully initialized, signal main thread
-  pthread_cond_signal(&a_c);
+  SetLightEvent(&a_ready);
   return handle;
 
 #undef alsaCheck
@@ -153,7 +154,7 @@ static snd_pcm_t *a_init(void) {
 }
 
 // Audio thread entry point
-static void *a_main(void *unused) {
+static void a_main(void *unused) {
   snd_pcm_t *handle;
   snd_pcm_sframes_t frames;
 
@@ -161,13 +162,13 @@ static void *a_main(void *unused) {
 
   // Initialize ALSA
   handle = a_init();
-  if (!handle) pthread_exit(NULL);
+  if (!handle) return;
 
   // Start sound loop
   snd_pcm_prepare(handle);
 
   for (;;) {
-    pthread_mutex_lock(&a_m);
+    LockLightMutex(&a_m);
 
     if (a_quit) break;
 
@@ -207,30 +208,29 @@ static void *a_main(void *unused) {
 
     // Time when play started
     a_bufPlayTime = GetTime();
-    pthread_mutex_unlock(&a_m);
+    UnlockLightMutex(&a_m);
 
     frames = snd_pcm_writei(handle, a_samples, A_BUFSIZE);
 
     if (frames == -EPIPE) { // Underrun
-      puts("Underrun");
+      LogString(g_streams, "Underrun");
       snd_pcm_prepare(handle);
     } else if (frames < 0) {
       // Irrecoverable error occurred, error out
       snd_pcm_drain(handle);
 
-      pthread_mutex_lock(&a_m);
+      LockLightMutex(&a_m);
       sprintf(a_errbuf, "Error playing samples! (%d, %s)\n", (int)frames, snd_strerror(frames));
-      pthread_mutex_unlock(&a_m);
+      UnlockLightMutex(&a_m);
       snd_pcm_close(handle);
-      pthread_exit(NULL);
+      return;
     }
   }
 
   // After setting a_quit, the main thread waits for this thread to shut down
   snd_pcm_drain(handle);
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
   snd_pcm_close(handle);
-  pthread_exit(NULL);
 }
 
 // Is sound system initialized?
@@ -244,7 +244,7 @@ void LoadSounds() {
   audio_frame_t *p;
 
   // Allocate sound buffer
-  p = s_soundBuf = (audio_frame_t*)Alloc(soundBufSize);
+  p = s_soundBuf = (audio_frame_t*)Alloc(soundBufSize, "Sound buffer");
 
   // Read raw sound data into sound buffer
   // and initialize s_sounds
@@ -272,72 +272,69 @@ void LoadSounds() {
 }
 
 void InitAudio() {
-  int err;
-
   LoadSounds();
 
-  a_samples = (i16*)Alloc(sizeof(i16)*A_CHANNELS*A_BUFSIZE);
+  a_samples = (i16*)Alloc(sizeof(i16)*A_CHANNELS*A_BUFSIZE, "Audio samples");
 
   memset(a_samples, 0, sizeof(i16)*A_CHANNELS*A_BUFSIZE);
 
-  err = pthread_create(&a_tid, NULL, a_main, NULL);
-  if (err) LOG_ERROR("Cannot create audio thread!");
+  InitLightMutex(&a_m);
+  InitLightEvent(&a_ready);
+
+  // The mixer has to keep up with the sound card, so
+  // keep other threads from preempting it
+  thread_attr_t attr = {};
+  attr.priority = THREAD_PRIO_REALTIME;
+  attr.name = "Audio";
+
+  if (!CreateThread(&a_thread, a_main, NULL, &attr)) LOG_ERROR("Cannot create audio thread!");
 
   // Wait for audio thread to initialize
-  pthread_cond_wait(&a_c, &a_m);
+  WaitLightEvent(&a_ready);
 
   // Check if an error occurred
   if (a_errbuf[0]) {
     LOG_INFO(a_errbuf);
-    pthread_mutex_unlock(&a_m);
     LOG_ERROR("An error occurred while initializing audio thread!");
   }
-
-  pthread_mutex_unlock(&a_m); // pthread_cond_wait automatically locks mutex
 }
 
 void FreeAudio() {
   if (!IsInitted()) return;
 
   a_quit = true;
-  pthread_join(a_tid, NULL);
+  WaitThread(&a_thread);
+  DestroyThread(&a_thread);
   if (a_bgm) CloseADPCM();
-  pthread_cond_destroy(&a_c);
-  pthread_mutex_unlock(&a_m);
-  pthread_mutex_destroy(&a_m);
 
   Free(a_samples);
   Free(s_soundBuf);
 }
 
-void PlayBGM(const char *filename) {
-  if (!IsInitted() ||
-      (filename && !strcmp(filename, a_bgmName)))
+void PlayBGM(asset_id_t bgm) {
+  if (!IsInitted() || (bgm == a_bgmId))
     return;
 
-  pthread_mutex_lock(&a_m);
+  LockLightMutex(&a_m);
 
   if (a_bgm) CloseADPCM();
   a_bgm = false;
 
-  if (!filename ||
-      !*filename ||
-      !OpenADPCM(filename))
-  {
-    memset(a_bgmName, 0, sizeof(a_bgmName));
-    pthread_mutex_unlock(&a_m);
+  if ((bgm == ASSET_NONE) || !OpenADPCM(GetAssetName(bgm))) {
+    a_bgmId = ASSET_NONE;
+    UnlockLightMutex(&a_m);
     return;
   }
 
-  strcpy(a_bgmName, filename);
+  a_bgmId = bgm;
   a_bgm = true;
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
 }
 
 sound_handle_t PlaySound(sound_t snd) {
   if (!IsInitted()) return 0;
 
-  pthread_mutex_lock(&a_m);
+  LockLightMutex(&a_m);
 
   // Play sound in first inactive channel
   uptr i;
@@ -354,7 +351,7 @@ sound_handle_t PlaySound(sound_t snd) {
   // Set start frame
   s_channels[i].startFrame = (GetTime()-a_bufPlayTime)*A_SAMPLERATE/g_timerFrequency;
 
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
 
   // If this channel stops, and start with another sound, and you
   // call StopSound on this channel handle... it'll stop the new sound
@@ -366,26 +363,26 @@ sound_handle_t PlaySound(sound_t snd) {
 void StopAllSounds() {
   if (!IsInitted()) return;
 
-  pthread_mutex_lock(&a_m);
+  LockLightMutex(&a_m);
   memset(s_channels, 0, sizeof(sound_channel)*SND_CHANNELS);
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
 }
 
 void StopSound(sound_t id) {
   if (!IsInitted()) return;
 
-  pthread_mutex_lock(&a_m);
+  LockLightMutex(&a_m);
   for (uptr i = 0; i < SND_CHANNELS; ++i)
     if (s_channels[i].id == id) s_channels[i].p = NULL; // Stop playing sound
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
 }
 
 void StopSound(sound_handle_t handle) {
   if (!IsInitted()) return;
 
-  pthread_mutex_lock(&a_m);
+  LockLightMutex(&a_m);
   ((sound_channel*)handle)->p = NULL;
-  pthread_mutex_unlock(&a_m);
+  UnlockLightMutex(&a_m);
 }
 
 // Empty function on linux
@@ -57,7 +57,7 @@ static AudioQueueBufferRef s_audioBuffers[NUM_BUFFERS];
 // Whether or not bgm is playing
 static bfast s_bgmPlaying = false;
 // Filename of bgm that's playing
-static char s_bgmName[64];
+static asset_id_t s_bgmId = ASSET_NONE;
 
 struct sound_channel {
   // If p == NULL, this sound channel is inactive
@@ -270,26 +270,21 @@ void FreeAudio() {
   [s_audioLock release];
 }
 
-void PlayBGM(const char *filename) {
-  if (filename && !strcmp(filename, s_bgmName)) return;
+void PlayBGM(asset_id_t bgm) {
+  if (bgm == s_bgmId) return;
 
   [s_audioLock lock];
 
   if (s_bgmPlaying) CloseADPCM();
   s_bgmPlaying = false;
 
-  if (!filename ||
-      !*filename ||
-      !OpenADPCM(filename))
-  {
-    memset(s_bgmName, 0, sizeof(s_bgmName));
+  if ((bgm == ASSET_NONE) || !OpenADPCM(GetAssetName(bgm))) {
+    s_bgmId = ASSET_NONE;
     [s_audioLock unlock];
     return;
   }
 
-  strncpy(s_bgmName, filename, sizeof(s_bgmName) - 1);
-  s_bgmName[sizeof(s_bgmName) - 1] = 0;
-
+  s_bgmId = bgm;
   s_bgmPlaying = true;
 
   [s_audioLock unlock];
@@ -55,7 +55,7 @@ static bfast s_running = true;
 timestamp_t g_timerFrequency = 0;
 
 // Global format string buffer used by FMT
-char g_fmtStr[FMTSTR_SIZE];
+thread_local char g_fmtStr[FMTSTR_SIZE];
 
 // Convert timestamp to microseconds
 static inline u32 TimeToMicro(timestamp_t time) {
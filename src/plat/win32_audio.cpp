@@ -62,7 +62,7 @@ static const IID IID_IAudioRenderClient = __uuidof(IAudioRenderClient);
 
 static bfast s_bgm; // Background music file handle
 
-static char s_bgmName[64];
+static asset_id_t s_bgmId = ASSET_NONE;
 
 struct sound_channel {
   // If p == NULL, this sound channel is inactive
@@ -84,7 +84,7 @@ void LoadSounds() {
   audio_frame_t *p;
 
   // Allocate sound buffer
-  p = s_soundBuf = (audio_frame_t*)Alloc(soundBufSize);
+  p = s_soundBuf = (audio_frame_t*)Alloc(soundBufSize, "Sound buffer");
 
   // Read raw sound data into sound buffer
   // and initialize s_sounds
@@ -203,20 +203,17 @@ void FreeAudio() {
   CoUninitialize();
 }
 
-void PlayBGM(const char *filename) {
-  if (filename && !strcmp(filename, s_bgmName)) return;
+void PlayBGM(asset_id_t bgm) {
+  if (bgm == s_bgmId) return;
   if (s_bgm) CloseADPCM();
   s_bgm = false;
 
-  if (!filename ||
-      !*filename ||
-      !OpenADPCM(filename))
-  {
-    memset(s_bgmName, 0, sizeof(s_bgmName));
+  if ((bgm == ASSET_NONE) || !OpenADPCM(GetAssetName(bgm))) {
+    s_bgmId = ASSET_NONE;
     return;
   }
 
-  strcpy(s_bgmName, filename);
+  s_bgmId = bgm;
   s_bgm = true;
 }
 
@@ -0,0 +1,294 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+
+#include "loveylib/types.h"
+#include "loveylib/file.h"
+#include "loveylib/heap.h"
+#include "loveylib/job.h"
+#include "loveylib/endian.h"
+#include "loveylib/assert.h"
+#include "loveylib_config.h"
+#include "log.h"
+#include "str.h"
+#include "room.h"
+#include "pack.h"
+
+#include <cstring>
+
+// Why a room couldn't be read
+enum room_error_e : ufast {
+  ROOM_OK = 0,
+  ROOM_CANT_OPEN,
+  ROOM_BAD_VERSION,
+  ROOM_CORRUPT,
+  ROOM_NOT_ROOM,
+};
+typedef ufast room_error_t;
+
+// Room pages are touched this far apart, so reading a
+// prefetched room doesn't fault
+static constexpr const uptr ROOM_TOUCH_STRIDE = 4096;
+
+struct cached_room_t {
+  // Room, ASSET_NONE if the entry isn't used
+  asset_id_t id;
+
+  // Room, NULL if it couldn't be read
+  // On little endian hosts, it's read straight out of file,
+  // otherwise it's a swapped copy in it's own heap
+  const room_t *room;
+  mapped_file_t file;
+
+  room_error_t error;
+  u16 version; // Version of the room, if it's the wrong one
+
+  u32 lastUse;
+
+  // Pending while the room is being read
+  job_counter_t reading;
+};
+
+static cached_room_t s_rooms[ROOM_CACHE_SIZE];
+static cached_room_t *s_curRoom;
+static u32 s_useCount;
+
+u32 RoomChecksum(const u8 *room, uptr size) {
+  u32 ret = 0x811c9dc5;
+  for (uptr i = 0; i < size; ++i) ret = (ret^room[i])*0x1000193;
+
+  return ret;
+}
+
+// Get offset of room in room file, skipping it's header
+// if it has one
+static uptr RoomOffset(const mapped_file_t *file) {
+  u32 magic;
+  if (file->size < sizeof(room_hdr_t)) return 0;
+
+  memcpy(&magic, file->data, 4);
+  return (magic == ROOM_MAGIC) ? sizeof(room_hdr_t) : 0;
+}
+
+// Map room file, checking it before it's used
+// Can be run from any thread
+static room_error_t ReadRoom(cached_room_t *r) {
+  mapped_file_t file;
+  if (!MapAsset(&file, GetAssetName(r->id))) return ROOM_CANT_OPEN;
+
+  const uptr offset = RoomOffset(&file);
+  const uptr size = file.size-offset;
+
+  if (offset) {
+    room_hdr_t hdr;
+    memcpy(&hdr, file.data, sizeof(hdr));
+    hdr.swap();
+
+    if (hdr.version != ROOM_VERSION) {
+      r->version = hdr.version;
+      UnmapAsset(&file);
+      return ROOM_BAD_VERSION;
+    }
+
+    if ((hdr.size != size) || (RoomChecksum(file.data+offset, size) != hdr.checksum)) {
+      UnmapAsset(&file);
+      return ROOM_CORRUPT;
+    }
+  }
+
+  // Make sure file size is valid
+  if (size <= sizeof(room_t)) {
+    UnmapAsset(&file);
+    return ROOM_NOT_ROOM;
+  }
+
+  // Make sure the entities and quads are in the file
+  const room_t *room = (const room_t*)(file.data+offset);
+  const uptr entityCount = LittleEndian32(room->entityCount);
+  const uptr quadCount = LittleEndian32(room->quadCount);
+  const uptr left = size-sizeof(room_t);
+
+  if ((entityCount > left/sizeof(entity_init_t)) ||
+      (quadCount > (left-entityCount*sizeof(entity_init_t))/sizeof(rquad_t)))
+  {
+    UnmapAsset(&file);
+    return ROOM_CORRUPT;
+  }
+
+#ifdef LOVEYLIB_LITTLE
+  // Older rooms aren't checksummed, so fault them in here
+  if (!offset) {
+    volatile u8 touch;
+    for (uptr i = 0; i < file.size; i += ROOM_TOUCH_STRIDE) touch = file.data[i];
+    (void)touch;
+  }
+
+  // Use the room where it's mapped
+  r->file = file;
+  r->room = room;
+#else
+  // Copy & swap room, the mapping is read-only
+  room_t *copy = (room_t*)InitHeap(size);
+  if (!copy) {
+    UnmapAsset(&file);
+    return ROOM_CANT_OPEN;
+  }
+
+  memcpy(copy, room, size);
+  UnmapAsset(&file);
+
+  copy->swap();
+  r->room = copy;
+#endif
+
+  return ROOM_OK;
+}
+
+// ReadRoom job
+static void ReadRoomJob(void *data) {
+  cached_room_t *r = (cached_room_t*)data;
+  r->error = ReadRoom(r);
+}
+
+// Drop cached room, waiting for it if it's being read
+static void DropCachedRoom(cached_room_t *r) {
+  WaitJobs(&r->reading);
+
+  if (r->file.data) UnmapAsset(&r->file);
+  else if (r->room) DestroyHeap((heap_t)r->room);
+
+  if (s_curRoom == r) s_curRoom = NULL;
+
+  r->id = ASSET_NONE;
+  r->room = NULL;
+  r->error = ROOM_OK;
+}
+
+// Find cached room
+// Returns NULL if the room isn't cached
+static cached_room_t *FindRoom(asset_id_t id) {
+  if (id == ASSET_NONE) return NULL;
+
+  for (cached_room_t *r = s_rooms; r != s_rooms+ROOM_CACHE_SIZE; ++r)
+    if (r->id == id) return r;
+
+  return NULL;
+}
+
+// Get entry for room, dropping the least recently used
+// room if the cache is full
+static cached_room_t *AddRoom(asset_id_t id) {
+  ASSERT(id != ASSET_NONE);
+
+  cached_room_t *ret = NULL;
+  for (cached_room_t *r = s_rooms; r != s_rooms+ROOM_CACHE_SIZE; ++r) {
+    if (r == s_curRoom) continue;
+
+    if (r->id == ASSET_NONE) {
+      ret = r;
+      break;
+    }
+
+    if (!ret || (r->lastUse < ret->lastUse)) ret = r;
+  }
+
+  DropCachedRoom(ret);
+  ret->id = id;
+  ret->lastUse = ++s_useCount;
+
+  return ret;
+}
+
+void InitRooms() {
+  for (cached_room_t *r = s_rooms; r != s_rooms+ROOM_CACHE_SIZE; ++r) {
+    r->id = ASSET_NONE;
+    r->room = NULL;
+    r->file.data = NULL;
+    r->error = ROOM_OK;
+    InitJobCounter(&r->reading);
+  }
+
+  s_curRoom = NULL;
+  s_useCount = 0;
+}
+
+void FreeRooms() {
+  for (cached_room_t *r = s_rooms; r != s_rooms+ROOM_CACHE_SIZE; ++r)
+    DropCachedRoom(r);
+}
+
+const room_t *GetRoom(asset_id_t id) {
+  cached_room_t *r = FindRoom(id);
+  if (!r) {
+    r = AddRoom(id);
+    r->error = ReadRoom(r);
+  } else {
+    WaitJobs(&r->reading);
+    r->lastUse = ++s_useCount;
+  }
+
+  const char * const filename = GetAssetName(id);
+  switch (r->error) {
+  case ROOM_OK: break;
+
+  case ROOM_CANT_OPEN: LOG_ERROR(FMT.s("Cannot open room ").s(filename).STR);
+  case ROOM_BAD_VERSION:
+    LOG_ERROR(FMT.s(filename).s(" is room version ").i(r->version).s(", expected ").i(ROOM_VERSION).STR);
+  case ROOM_CORRUPT: LOG_ERROR(FMT.s(filename).s(" is corrupt!").STR);
+  default: LOG_ERROR(FMT.s(filename).s(" isn't a room!").STR);
+  }
+
+  s_curRoom = r;
+  return r->room;
+}
+
+void PrefetchRoom(asset_id_t id) {
+  cached_room_t *r = FindRoom(id);
+  if (r) {
+    r->lastUse = ++s_useCount;
+    return;
+  }
+
+  r = AddRoom(id);
+  RunJob(ReadRoomJob, r, &r->reading);
+}
+
+bfast PollRoom(asset_id_t id, const room_t **out) {
+  const cached_room_t *r = FindRoom(id);
+  if (r && r->reading.pending.load(std::memory_order_acquire)) return false;
+
+  *out = r ? r->room : NULL;
+  return true;
+}
+
+void DropRoom(asset_id_t id) {
+  cached_room_t *r = FindRoom(id);
+  if (r) DropCachedRoom(r);
+}
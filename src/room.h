@@ -0,0 +1,81 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#ifndef _ROOM_H
+#define _ROOM_H
+
+#include "loveylib/types.h"
+#include "game.h"
+#include "asset.h"
+
+/*
+ * Room cache
+ *
+ * Rooms are kept once they're read, and the least recently
+ * used room is dropped when a new one needs to be read. The
+ * current room, the last one returned by GetRoom, is never
+ * dropped.
+ *
+ * Rooms can be prefetched, which reads them as a job, so
+ * getting them later doesn't touch the disk. Only the game
+ * thread can use the cache.
+ */
+
+// Rooms kept at once
+static constexpr const uptr ROOM_CACHE_SIZE = 8;
+
+// Initialize room cache
+void InitRooms();
+
+// Drop every room in the cache
+void FreeRooms();
+
+// Get room, reading it if it isn't cached, and waiting
+// for it if it's being prefetched
+// Quits if the room can't be read
+const room_t *GetRoom(asset_id_t id);
+
+// Start reading room in the background, if it isn't cached
+void PrefetchRoom(asset_id_t id);
+
+// Check if a prefetched room is done being read
+// Returns false if it's still being read, otherwise sets
+// *out to the room, or NULL if it couldn't be read or
+// isn't cached
+bfast PollRoom(asset_id_t id, const room_t **out);
+
+// Drop room from the cache, even if it's the current room,
+// so it's read again next time
+void DropRoom(asset_id_t id);
+
+// FNV-1a hash of room, stored in it's header
+u32 RoomChecksum(const u8 *room, uptr size);
+
+#endif //_ROOM_H
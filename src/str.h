@@ -35,7 +35,12 @@
 #include "loveylib/string.h"
 
 static constexpr const uptr FMTSTR_SIZE = 4096;
-extern char g_fmtStr[FMTSTR_SIZE];
+
+// Every thread has its own format buffer, so FMT can be used from
+// any thread, but a string from FMT only lasts until the next FMT
+// on the same thread. To keep it longer, format into your own buffer
+// with format_buf_t(buf).s(...).str(buf)
+extern thread_local char g_fmtStr[FMTSTR_SIZE];
 
 // Usage: FMT.s(...).i(...).f(...) <...> .i(...).STR
 #define FMT format_buf_t(g_fmtStr)
@@ -0,0 +1,121 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#include "loveylib/types.h"
+#include "loveylib/file.h"
+#include "loveylib/job.h"
+#include "loveylib/timer.h"
+#include "log.h"
+#include "telemetry.h"
+
+u8 *g_telemetryBuf = NULL;
+uptr g_telemetrySize = 0;
+u32 g_telemetryDropped = 0;
+
+// Events are recorded into one buffer while the other is written
+static u8 s_buffers[2][TELEMETRY_BUFFER_SIZE];
+static stream_t s_file;
+
+// Buffer being written by WriteTelemetryJob
+static const u8 *s_writeBuf;
+static uptr s_writeSize;
+static job_counter_t s_writing;
+
+// Write s_writeBuf to the telemetry file
+static void WriteTelemetryJob(void*) {
+  if (WriteStream(&s_file, s_writeBuf, s_writeSize) != (iptr)s_writeSize)
+    LOG_STATUS("Couldn't write telemetry!");
+}
+
+// Write recorded events, and switch buffers
+static void WriteTelemetry() {
+  if (g_telemetryDropped) {
+    // Written into the space kept for it
+    u8 * const p = g_telemetryBuf+g_telemetrySize;
+    WriteEventHdr(p, TEL_DROPPED, 4);
+    WriteEventArgs(p+TELEMETRY_RECORD_HDR_SIZE, g_telemetryDropped);
+
+    g_telemetrySize += TELEMETRY_RESERVED_SIZE;
+    g_telemetryDropped = 0;
+  }
+
+  s_writeBuf = g_telemetryBuf;
+  s_writeSize = g_telemetrySize;
+  RunJob(WriteTelemetryJob, NULL, &s_writing);
+
+  g_telemetryBuf = (g_telemetryBuf == s_buffers[0]) ? s_buffers[1] : s_buffers[0];
+  g_telemetrySize = 0;
+}
+
+bfast InitTelemetry() {
+  s_file.init();
+  if (!OpenFile(&s_file, TELEMETRY_FILENAME, FILE_WRITE_ONLY)) return false;
+
+  telemetry_file_hdr_t hdr = {};
+  hdr.magic = TELEMETRY_MAGIC;
+  hdr.version = TELEMETRY_VERSION;
+  hdr.eventCount = TEL_COUNT;
+  hdr.timerFrequency = GetTimerFrequency();
+
+  if (WriteStream(&s_file, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+    CloseFile(&s_file);
+    return false;
+  }
+
+  InitJobCounter(&s_writing);
+
+  g_telemetryBuf = s_buffers[0];
+  g_telemetrySize = 0;
+  g_telemetryDropped = 0;
+
+  return true;
+}
+
+void FreeTelemetry() {
+  if (!g_telemetryBuf) return;
+
+  WaitJobs(&s_writing);
+  if (g_telemetrySize || g_telemetryDropped) {
+    WriteTelemetry();
+    WaitJobs(&s_writing);
+  }
+
+  CloseFile(&s_file);
+  g_telemetryBuf = NULL;
+}
+
+void FlushTelemetry() {
+  if (!g_telemetryBuf || (g_telemetrySize < TELEMETRY_WRITE_SIZE)) return;
+
+  // Keep recording into this buffer until the last write is done
+  if (s_writing.pending.load(std::memory_order_acquire)) return;
+
+  WriteTelemetry();
+}
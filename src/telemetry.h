@@ -0,0 +1,177 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include "loveylib/types.h"
+#include "loveylib/timer.h"
+#include "loveylib/assert.h"
+
+#include <cstring>
+
+/*
+ * Telemetry
+ *
+ * Binary event log, cheap enough to stay on in release builds.
+ * An event is recorded as its ID, the time from GetTime() and its
+ * arguments' raw bytes. Nothing is formatted in the game, the
+ * decodeTelemetry tool formats events offline with the format
+ * strings in S_TelemetryEvents.
+ *
+ * Events are recorded into a buffer, and FlushTelemetry writes
+ * it to TELEMETRY_FILENAME with a job once enough is recorded.
+ * If the buffer fills up before that, events are dropped and
+ * counted with a TEL_DROPPED event.
+ *
+ * Only the game thread can record events.
+ *
+ * The file starts with a telemetry_file_hdr_t, followed by
+ * records, in the byte order of the machine that wrote them:
+ *   u64 time, u16 event, u16 size, then size bytes of arguments
+ */
+
+static constexpr const char * const TELEMETRY_FILENAME = "telemetry.bin";
+
+static constexpr const u32 TELEMETRY_MAGIC = 'I' | ('W'<<8) | ('T'<<16) | ('M'<<24);
+static constexpr const u16 TELEMETRY_VERSION = 1;
+
+// Bytes before a record's arguments
+static constexpr const uptr TELEMETRY_RECORD_HDR_SIZE = 12;
+
+// Size of each event buffer
+static constexpr const uptr TELEMETRY_BUFFER_SIZE = 64*1024;
+
+// Kept at the end of each buffer for a TEL_DROPPED event
+static constexpr const uptr TELEMETRY_RESERVED_SIZE = TELEMETRY_RECORD_HDR_SIZE+4;
+
+// Buffers are written once this much is recorded
+static constexpr const uptr TELEMETRY_WRITE_SIZE = 16*1024;
+
+struct telemetry_file_hdr_t {
+  u32 magic; // == TELEMETRY_MAGIC
+  u16 version; // == TELEMETRY_VERSION
+  u16 eventCount; // == TEL_COUNT
+  u64 timerFrequency; // GetTimerFrequency()
+};
+
+// Screw you emacs
+#define telemetry_event_e telemetry_event_e : u16
+enum telemetry_event_e {
+  TEL_DROPPED = 0,
+  TEL_FRAME,
+  TEL_UPDATE,
+  TEL_ALLOC,
+  TEL_ALLOC_FAILED,
+
+  TEL_COUNT
+};
+#undef telemetry_event_e
+typedef u16 telemetry_event_t;
+
+struct telemetry_event_info_t {
+  // printf-like format, arguments are read by their conversion:
+  // %u = u32, %i = i32, %f = f32, %U = u64
+  const char *format;
+
+  // Bytes of arguments
+  u16 size;
+};
+
+static const telemetry_event_info_t S_TelemetryEvents[TEL_COUNT] = {
+  {"Dropped %u events", 4}, // TEL_DROPPED
+  {"Frame took %u us", 4}, // TEL_FRAME
+  {"%u entities, %u collision queries, %u scratch bytes", 12}, // TEL_UPDATE
+  {"Allocated %u bytes", 4}, // TEL_ALLOC
+  {"Couldn't allocate %u bytes", 4}, // TEL_ALLOC_FAILED
+};
+
+// Buffer events are recorded into, NULL if telemetry is off
+extern u8 *g_telemetryBuf;
+extern uptr g_telemetrySize; // Bytes recorded
+extern u32 g_telemetryDropped;
+
+// Open TELEMETRY_FILENAME, and start recording events
+// Returns false if it can't be opened, events are ignored then
+bfast InitTelemetry();
+
+// Write out every recorded event, and close the file
+void FreeTelemetry();
+
+// Start writing recorded events, call once per frame
+void FlushTelemetry();
+
+// Size of event arguments
+template<typename... T>
+struct event_args_size_t {
+  static constexpr const uptr size = 0;
+};
+template<typename T, typename... R>
+struct event_args_size_t<T, R...> {
+  static constexpr const uptr size = sizeof(T) + event_args_size_t<R...>::size;
+};
+
+// Write record header
+static inline void WriteEventHdr(u8 *out, telemetry_event_t event, u16 argSize) {
+  const timestamp_t time = GetTime();
+
+  memcpy(out, &time, 8);
+  memcpy(out+8, &event, 2);
+  memcpy(out+10, &argSize, 2);
+}
+
+// Copy event arguments into record
+static inline void WriteEventArgs(u8*) {}
+template<typename T, typename... R>
+static inline void WriteEventArgs(u8 *out, const T &arg, const R &...rest) {
+  memcpy(out, &arg, sizeof(T));
+  WriteEventArgs(out+sizeof(T), rest...);
+}
+
+// Record event, arguments must match the event's format
+template<typename... T>
+static inline void RecordEvent(telemetry_event_t event, const T &...args) {
+  constexpr const u16 argSize = event_args_size_t<T...>::size;
+  constexpr const uptr size = TELEMETRY_RECORD_HDR_SIZE+argSize;
+  ASSERT(argSize == S_TelemetryEvents[event].size);
+
+  if (!g_telemetryBuf) return;
+  if (TELEMETRY_BUFFER_SIZE-TELEMETRY_RESERVED_SIZE-g_telemetrySize < size) {
+    ++g_telemetryDropped;
+    return;
+  }
+
+  u8 * const p = g_telemetryBuf+g_telemetrySize;
+  WriteEventHdr(p, event, argSize);
+  WriteEventArgs(p+TELEMETRY_RECORD_HDR_SIZE, args...);
+
+  g_telemetrySize += size;
+}
+
+#endif //_TELEMETRY_H
@@ -65,4 +65,19 @@ struct alignas(64) rquad_t {
   vertex_t v[4];
 };
 
+// Write quad to out count times, offset by each (x[i], y[i])
+static inline void ExpandQuadInstances(vertex_t *out, const rquad_t *quad,
+                                       const f32 *x, const f32 *y, uptr count)
+{
+  for (uptr i = 0; i < count; ++i, out += 4) {
+    // w holds texture coordinates, leave it alone
+    const vec4 off = VEC4(x[i], y[i], 0.f, 0.f);
+
+    out[0].pos = quad->v[0].pos+off;
+    out[1].pos = quad->v[1].pos+off;
+    out[2].pos = quad->v[2].pos+off;
+    out[3].pos = quad->v[3].pos+off;
+  }
+}
+
 #endif //_VERTEX_H
@@ -28,8 +28,11 @@
  *
  ************************************************************/
 
+#include "page.h"
+
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #define ERR(condition, msg) if (condition) {puts(msg); exit(1);}
 
@@ -104,17 +107,63 @@ static void WritePixel(FILE *out, unsigned pixel, bool flushBlock = false) {
   ERR(curBlock.marker.magic == 0x80, "A pixel in this page has the same alpha as the RLE marker magic!");
 }
 
+// Write v2 page, see src/page.h
+// Little endian dependent, don't care
+static bool WritePageV2(FILE *out, const unsigned *page) {
+  static page_encoder_t encoder;
+  static page_band_t bands[PAGE_BANDS];
+
+  page_hdr_t hdr;
+  hdr.magic = PAGE_MAGIC;
+  hdr.version = PAGE_VERSION;
+  hdr.bandCount = PAGE_BANDS;
+  hdr.width = PAGE_WIDTH;
+  hdr.height = PAGE_HEIGHT;
+
+  // Band table is written after the bands
+  fseek(out, PAGE_TABLE_SIZE, SEEK_SET);
+
+  unsigned offset = PAGE_TABLE_SIZE;
+  for (size_t i = 0; i < PAGE_BANDS; ++i) {
+    const u8 *band;
+    uptr size = EncodePageBand(&encoder, page + i*PAGE_BAND_PIXELS, &band);
+
+    if (fwrite(band, 1, size, out) < size) return false;
+
+    bands[i].offset = offset;
+    bands[i].size = size;
+    offset += size;
+  }
+
+  fseek(out, 0, SEEK_SET);
+  if (fwrite(&hdr, sizeof(hdr), 1, out) < 1) return false;
+  if (fwrite(bands, sizeof(bands), 1, out) < 1) return false;
+
+  printf("Wrote %u bytes\n", offset);
+  return true;
+}
+
 int main(int argc, char **argv) {
+  // -z selects the v2 page format
+  bool v2 = false;
+  if ((argc > 1) && !strcmp(argv[1], "-z")) {
+    v2 = true;
+    --argc;
+    ++argv;
+  }
+
   if (!GetFilename(argc, argv)) {
-    printf("Usage: %s <page number>\n"
+    printf("Usage: %s [-z] <page number>\n"
            "\n"
-           "Converts <page>.bmp to ../<page>\n", argv[0]);
+           "Converts <page>.bmp to ../<page>c\n"
+           "With -z, converts <page>.bmp to ../<page>z, a v2 page\n", argv[0]);
     return 0;
   }
 
   char name[6] = " .bmp";
   char outName[6] = "../ c";
   name[0] = outName[3] = argv[1][0];
+  if (v2) outName[4] = 'z';
 
   FILE *f = fopen(name, "rb");
   if (!f) {
@@ -132,22 +181,37 @@ int main(int argc, char **argv) {
   // Seek to last line
   fseek(f, 2048*2047*4 + 0x46, SEEK_SET);
 
+  // v2 pages are compressed a band at a time, so read the whole image
+  unsigned *page = NULL;
+  if (v2) {
+    page = (unsigned*)malloc(2048*2048*4);
+    ERR(!page, "Out of memory!");
+  }
+
   // Start reading 2048 lines from f to out
   for (size_t i = 0; i < 2048; ++i) {
-    if (fread(s_imageRow, 4, 2048, f) < 2048) {
+    unsigned *row = v2 ? page + i*2048 : s_imageRow;
+
+    if (fread(row, 4, 2048, f) < 2048) {
       puts("Couldn't read image row!");
       fclose(f);
       fclose(out);
       return 1;
     }
 
-    for (size_t j = 0; j < 2048; ++j)
-      WritePixel(out, s_imageRow[j]);
+    if (!v2) {
+      for (size_t j = 0; j < 2048; ++j)
+        WritePixel(out, s_imageRow[j]);
+    }
 
     fseek(f, -4096*4, SEEK_CUR);
   }
 
-  FlushLastBlock(out);
+  if (v2) {
+    ERR(!WritePageV2(out, page), "Couldn't write page!");
+    free(page);
+  } else FlushLastBlock(out);
+
   fclose(f);
   fclose(out);
 
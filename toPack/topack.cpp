@@ -0,0 +1,143 @@
+/************************************************************
+ *
+ * Copyright (c) 2022 Lian Ferrand
+ *
+ * Permission is hereby granted, free of charge, to any
+ * person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the
+ * Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the
+ * Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice
+ * shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY
+ * KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+ * OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * This file is part of I Wanna Slay the Dragon of Bangan
+ *
+ ************************************************************/
+
+#include "pack.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#define ERR(condition, msg) if (condition) {puts(msg); exit(1);}
+
+// Sort directory by hash, then by name so packs are reproducible
+static bool EntryLess(const pack_entry_t &a, const pack_entry_t &b) {
+  if (a.hash != b.hash) return a.hash < b.hash;
+  return strcmp(a.name, b.name) < 0;
+}
+
+// Copy file into pack
+// Returns file size
+static unsigned long CopyFile(FILE *out, const char *name) {
+  static char buf[65536];
+
+  FILE *f = fopen(name, "rb");
+  if (!f) {
+    printf("Cannot open \"%s\"!\n", name);
+    exit(1);
+  }
+
+  unsigned long size = 0;
+  size_t ret;
+  while ((ret = fread(buf, 1, sizeof(buf), f)) > 0) {
+    ERR(fwrite(buf, 1, ret, out) < ret, "Couldn't write pack!");
+    size += ret;
+  }
+
+  fclose(f);
+  return size;
+}
+
+// Pad pack to PACK_ALIGNMENT
+static unsigned long AlignPack(FILE *out, unsigned long pos) {
+  static const char zero[PACK_ALIGNMENT] = {};
+
+  const unsigned long pad = (PACK_ALIGNMENT - pos%PACK_ALIGNMENT) % PACK_ALIGNMENT;
+  ERR(fwrite(zero, 1, pad, out) < pad, "Couldn't write pack!");
+
+  return pos+pad;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    printf("Usage: %s <pack> <asset>...\n"
+           "\n"
+           "Packs every asset into <pack>, assets are named by their path\n"
+           "Run from the game directory, e.g.\n"
+           "  %s data.pak data/room/*.rm data/page/* data/snd/*.wav data/bgm/*.wav\n",
+           argv[0], argv[0]);
+    return 0;
+  }
+
+  const size_t count = argc-2;
+  pack_entry_t *entries = (pack_entry_t*)calloc(count, sizeof(pack_entry_t));
+  ERR(!entries, "Out of memory!");
+
+  FILE *out = fopen(argv[1], "wb");
+  if (!out) {
+    printf("Cannot open \"%s\"!\n", argv[1]);
+    return 1;
+  }
+
+  // Entries are written after the directory
+  unsigned long pos = sizeof(pack_hdr_t) + count*sizeof(pack_entry_t);
+  fseek(out, pos, SEEK_SET);
+
+  for (size_t i = 0; i < count; ++i) {
+    const char *name = argv[i+2];
+    if (strlen(name) >= PACK_NAME_LENGTH) {
+      printf("\"%s\" is too long a name!\n", name);
+      return 1;
+    }
+
+    pos = AlignPack(out, pos);
+
+    strcpy(entries[i].name, name);
+    entries[i].hash = HashAssetName(name);
+    entries[i].offset = pos;
+    entries[i].size = CopyFile(out, name);
+
+    pos += entries[i].size;
+  }
+
+  std::sort(entries, entries+count, EntryLess);
+  for (size_t i = 1; i < count; ++i) {
+    if (!strcmp(entries[i-1].name, entries[i].name)) {
+      printf("\"%s\" is packed twice!\n", entries[i].name);
+      return 1;
+    }
+  }
+
+  pack_hdr_t hdr = {};
+  hdr.magic = PACK_MAGIC;
+  hdr.version = PACK_VERSION;
+  hdr.entryCount = count;
+
+  // Little endian dependent, don't care
+  fseek(out, 0, SEEK_SET);
+  ERR(fwrite(&hdr, sizeof(hdr), 1, out) < 1, "Couldn't write pack!");
+  ERR(fwrite(entries, sizeof(pack_entry_t), count, out) < count, "Couldn't write pack!");
+
+  fclose(out);
+  free(entries);
+
+  printf("Packed %lu assets, %lu bytes\n", (unsigned long)count, pos);
+  return 0;
+}